@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "util.h" //fast rand, timer
+
+//small integer keys with the identity hash (the same weak hash tests/jadwal_test.c uses)
+//the strided keys only differ in their high bits, which is what hurts a table that masks the hash directly
+#define NKEYS  (1 << 20)
+#define STRIDE 4096
+#define BATCH  256 //keys per jadwal_find_batch()
+
+typedef long jadwal_key_type;
+typedef int jadwal_value_type;
+
+static size_t jadwal_hash(jadwal_key_type *key) {
+    return (size_t) *key;
+}
+
+//must return zero when equal
+static int jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return *key_1 != *key_2;
+}
+
+#include "../src/jadwal.h"
+
+#ifndef NTHREADS
+#define NTHREADS 4 //with JADWAL_PARALLEL_RESIZE
+#endif
+static int bench_init(struct jadwal *ht) {
+    int rv = jadwal_init(ht, 0);
+#ifdef JADWAL_PARALLEL_RESIZE
+    if (rv == JADWAL_OK)
+        rv = jadwal_set_task_runner(ht, jadwal_run_tasks_pthreads, NTHREADS);
+#endif
+    return rv;
+}
+
+static void bench_keys(const char *name, long stride) {
+    struct jadwal ht;
+    int rv = bench_init(&ht);
+    assert(rv == JADWAL_OK);
+
+    struct timer_info tm_init;
+    struct timer_info tm_tmp;
+    timer_begin(&tm_init);
+    timer_begin(&tm_tmp);
+    printf("%s keys\n", name);
+
+    for (int i=0; i<NKEYS; i++) {
+        long key = (long) i * stride;
+        int rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    printf("insertion time: %f\n", timer_dt(&tm_tmp));
+    timer_begin(&tm_tmp);
+    xorshf96_srand(0xfeedbeef);
+
+    for (int i=0; i<NKEYS; i++) {
+        int idx = xorshf96() % NKEYS;
+        long key = (long) idx * stride;
+        struct jadwal_iter iter;
+        int rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK);
+        assert(*jadwal_iter_value(&iter) == idx);
+    }
+    printf("lookup time:    %f\n", timer_dt(&tm_tmp));
+    timer_begin(&tm_tmp);
+    xorshf96_srand(0xfeedbeef);
+
+    //the same lookups, BATCH at a time
+    for (int i=0; i<NKEYS; i+=BATCH) {
+        long batch_keys[BATCH];
+        int batch_idx[BATCH];
+        struct jadwal_iter batch_iters[BATCH];
+        for (int j=0; j<BATCH; j++) {
+            batch_idx[j] = xorshf96() % NKEYS;
+            batch_keys[j] = (long) batch_idx[j] * stride;
+        }
+        int rv = jadwal_find_batch(&ht, batch_keys, BATCH, batch_iters, NULL);
+        assert(rv == JADWAL_OK);
+        for (int j=0; j<BATCH; j++)
+            assert(*jadwal_iter_value(&batch_iters[j]) == batch_idx[j]);
+    }
+    printf("batch lookup:   %f\n", timer_dt(&tm_tmp));
+    timer_begin(&tm_tmp);
+    for (int i=0; i<NKEYS; i++) {
+        //never inserted, in between the inserted keys (or past them for the sequential ones)
+        long key = stride > 1 ? (long) i * stride + 1 : (long) NKEYS + i;
+        struct jadwal_iter iter;
+        int rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    printf("miss time:      %f\n", timer_dt(&tm_tmp));
+    timer_begin(&tm_tmp);
+    for (int i=NKEYS-1; i>=0; i--) {
+        long key = (long) i * stride;
+        int rv = jadwal_remove(&ht, &key);
+        assert(rv == JADWAL_OK);
+    }
+    printf("deletion time:  %f\n", timer_dt(&tm_tmp));
+    printf("total time:     %f\n", timer_dt(&tm_init));
+#ifdef JADWAL_STATS
+    printf("avg probe len:  %f\n", ht.stats.nlookups ? (double) ht.stats.nprobes / ht.stats.nlookups : 0.0);
+    printf("max probe len:  %ld\n", ht.stats.max_probe_len);
+#endif
+    jadwal_deinit(&ht);
+}
+
+//the slowest single insert while loading NKEYS keys, that's the one that had to grow the table (or with
+//JADWAL_INCREMENTAL, a bounded part of that)
+static void bench_worst_insert(void) {
+    struct jadwal ht;
+    int rv = bench_init(&ht);
+    assert(rv == JADWAL_OK);
+    double worst = 0.0;
+    double total = 0.0;
+    for (int i=0; i<NKEYS; i++) {
+        long key = i;
+        struct timer_info tm;
+        timer_begin(&tm);
+        int rv = jadwal_insert(&ht, &key, &i);
+        double dt = timer_dt(&tm);
+        assert(rv == JADWAL_OK);
+        worst = dt > worst ? dt : worst;
+        total += dt;
+    }
+    printf("per insert\n");
+    printf("average time:   %f us\n", 1e6 * total / NKEYS);
+    printf("worst time:     %f us\n", 1e6 * worst);
+    jadwal_deinit(&ht);
+}
+
+//random keys into a table that already has room for all of them (so both make the same resizes, none), one insert at a
+//time and then INSERT_BATCH at a time with jadwal_insert_batch()
+#define INSERT_BATCH 4096
+static long random_keys[NKEYS];
+static int random_values[NKEYS];
+static void bench_random_keys(void) {
+    xorshf96_srand(0xdecade);
+    for (int i=0; i<NKEYS; i++) {
+        random_keys[i] = ((long) xorshf96() << 20) ^ i; //distinct
+        random_values[i] = i;
+    }
+}
+static void bench_insert_batch(void) {
+    long *keys = random_keys;
+    int *values = random_values;
+    printf("random keys\n");
+    struct jadwal ht;
+    int rv = bench_init(&ht);
+    assert(rv == JADWAL_OK && jadwal_reserve(&ht, NKEYS) == JADWAL_OK);
+    struct timer_info tm;
+    timer_begin(&tm);
+    for (int i=0; i<NKEYS; i++) {
+        rv = jadwal_insert(&ht, &keys[i], &values[i]);
+        assert(rv == JADWAL_OK);
+    }
+    printf("insertion time: %f\n", timer_dt(&tm));
+    jadwal_deinit(&ht);
+
+    rv = bench_init(&ht);
+    assert(rv == JADWAL_OK && jadwal_reserve(&ht, NKEYS) == JADWAL_OK);
+    timer_begin(&tm);
+    for (int i=0; i<NKEYS; i+=INSERT_BATCH) {
+        rv = jadwal_insert_batch(&ht, keys + i, values + i, INSERT_BATCH, false, NULL);
+        assert(rv == JADWAL_OK);
+    }
+    printf("batch insert:   %f\n", timer_dt(&tm));
+    assert(jadwal_count(&ht) == NKEYS);
+    jadwal_deinit(&ht);
+}
+
+//the same random keys loaded into a fresh table one insert at a time (growing as it goes) and with jadwal_build_from()
+//(sized once, with JADWAL_PARALLEL_RESIZE filled by NTHREADS threads)
+static void bench_build(void) {
+    struct jadwal ht;
+    int rv = bench_init(&ht);
+    assert(rv == JADWAL_OK);
+    struct timer_info tm;
+    timer_begin(&tm);
+    for (int i=0; i<NKEYS; i++) {
+        rv = jadwal_insert(&ht, &random_keys[i], &random_values[i]);
+        assert(rv == JADWAL_OK);
+    }
+    printf("load time:      %f\n", timer_dt(&tm));
+    jadwal_deinit(&ht);
+
+    rv = bench_init(&ht);
+    assert(rv == JADWAL_OK);
+    timer_begin(&tm);
+    rv = jadwal_build_from(&ht, random_keys, random_values, NKEYS);
+    assert(rv == JADWAL_OK);
+    printf("build time:     %f\n", timer_dt(&tm));
+    assert(jadwal_count(&ht) == NKEYS);
+    jadwal_deinit(&ht);
+}
+
+int main(void) {
+    bench_keys("sequential", 1);
+    bench_keys("strided", STRIDE);
+    bench_random_keys();
+    bench_insert_batch();
+    bench_build();
+    bench_worst_insert();
+    printf("success\n");
+}
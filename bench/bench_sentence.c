@@ -11,6 +11,8 @@
  *      print the result to the file output_sentence<BENCH POSTFIX>.txt
  *      deallocate the memory of the result
     deallocate the table
+ * with JADWAL_ARENA the sentences are allocated from the arena of the table, the output loop doesn't free them,
+ * jadwal_deinit() does that at once
  */
 
 #define OUTPUT_FNAME "bench_sentence.txt"
@@ -55,6 +57,26 @@ void *xmalloc(size_t sz) {
     return m;
 }
 
+//the memory of a sentence, bench_free() gets the size back from its length
+char *bench_alloc(struct jadwal *ht, size_t sz) {
+#ifdef JADWAL_ARENA
+    char *m = jadwal_arena_alloc(ht, sz);
+    assertx(!!m);
+    return m;
+#else
+    (void) ht;
+    return xmalloc(sz);
+#endif
+}
+void bench_free(struct jadwal *ht, char *sentence) {
+#ifdef JADWAL_ARENA
+    jadwal_arena_free(ht, sentence, strlen(sentence) + 1);
+#else
+    (void) ht;
+    free(sentence);
+#endif
+}
+
 void sep_word(const char *sentence, const char **word2) {
     const char *space = strchr(sentence, ' ');
     if (space)
@@ -87,7 +109,7 @@ int main(void) {
         int sentence_cur = 0;
         for (int i=0; i<3; i++) 
             sentence_len += strlen(words[words_idx[i]]) + 1;
-        char *sentence = xmalloc(sentence_len);
+        char *sentence = bench_alloc(&ht, sentence_len);
         for (int i=0; i<3; i++) {
             const char *word = words[words_idx[i]];
             memcpy(sentence + sentence_cur, word, strlen(word));
@@ -113,9 +135,9 @@ int main(void) {
             assert(rv == JADWAL_NOT_FOUND);
             continue;
         }
-        assert(iter.pair);
-        assert(iter.pair->value);
-        const char *sentence = iter.pair->value;
+        assert(jadwal_iter_key(&iter));
+        assert(*jadwal_iter_value(&iter));
+        const char *sentence = *jadwal_iter_value(&iter);
         const char *next_word = sentence;
         for (int j=0; j<2; j++) {
             sep_word(next_word, &next_word);
@@ -126,9 +148,9 @@ int main(void) {
                 assert(rv == JADWAL_NOT_FOUND);
                 continue;
             }
-            assert(it.pair->value);
-            free(it.pair->value);
-            rv = jadwal_remove(&ht, &next_word);
+            assert(*jadwal_iter_value(&it));
+            bench_free(&ht, *jadwal_iter_value(&it));
+            rv = jadwal_remove_iter(&ht, &it); //no second lookup
             assert(rv == JADWAL_OK);
         }
     }
@@ -146,11 +168,13 @@ int main(void) {
             assert(rv == JADWAL_NOT_FOUND);
             continue;
         }
-        assert(iter.pair);
-        assert(iter.pair->value);
-        char *sentence = iter.pair->value;
+        assert(jadwal_iter_key(&iter));
+        assert(*jadwal_iter_value(&iter));
+        char *sentence = *jadwal_iter_value(&iter);
         fprintf(fout, "%s\n", sentence);
+#ifndef JADWAL_ARENA
         free(sentence);
+#endif
     }
 
 
@@ -158,6 +182,10 @@ int main(void) {
     fout = NULL;
     printf("output time: %f\n", timer_dt(&tm_tmp));
     printf("total time:     %f\n", timer_dt(&tm_init));
+#ifdef JADWAL_STATS
+    printf("avg probe len:  %f\n", ht.stats.nlookups ? (double) ht.stats.nprobes / ht.stats.nlookups : 0.0);
+    printf("max probe len:  %ld\n", ht.stats.max_probe_len);
+#endif
     printf("success\n");
     jadwal_deinit(&ht);
 }
@@ -8,6 +8,25 @@
 #include "util.h" //fast rand, timer
 
 
+#ifdef JADWAL_STR_KEYS
+//the key keeps the length (and with JADWAL_STR_PREFIX the first 8 bytes), the table compares those before the strings
+//with JADWAL_STR_INLINE most words are copied into the buckets
+#define JADWAL_STR_HASH(ptr, len) SuperFastHash((ptr), (len))
+#define JADWAL_PREFETCH_KEY(key) __builtin_prefetch(jadwal_str_data(key))
+typedef int jadwal_value_type; 
+#include "../src/jadwal.h"
+static jadwal_key_type bench_key(const char *str, size_t len) {
+    return jadwal_str_make(str, len);
+}
+static bool bench_key_is(jadwal_key_type *key, const char *word) {
+#ifdef JADWAL_STR_INLINE
+    //a short key is a copy, the assert on the value next to this one is what tells it's the right key
+    if (key->len <= JADWAL_STR_INLINE_MAX)
+        return true;
+#endif
+    return jadwal_str_data(key) == word;
+}
+#else
 typedef const char * jadwal_key_type; 
 typedef int jadwal_value_type; 
 
@@ -24,9 +43,28 @@ static int jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
     return strcmp(*key_1, *key_2);
 }
 
+//jadwal_find_batch() prefetches the string of a likely match before comparing
+#define JADWAL_PREFETCH_KEY(key) __builtin_prefetch(*(key))
 #include "../src/jadwal.h"
+static jadwal_key_type bench_key(const char *str, size_t len) {
+    (void) len;
+    return str;
+}
+static bool bench_key_is(jadwal_key_type *key, const char *word) {
+    return *key == word;
+}
+#endif
+
+#define BATCH 256
+
+//the keys that are inserted, made before timing anything
+static jadwal_key_type *keys;
 
 int main(void) {
+    keys = malloc(nwords * sizeof *keys);
+    assert(keys);
+    for (int i=0; i<nwords; i++)
+        keys[i] = bench_key(words[i], strlen(words[i]));
     struct jadwal ht;
     int rv = jadwal_init(&ht, 0);
     assert(rv == JADWAL_OK);
@@ -37,7 +75,7 @@ int main(void) {
     timer_begin(&tm_tmp);
 
     for (int i=0; i<nwords; i++) {
-        int rv = jadwal_insert(&ht, &words[i], &i);
+        int rv = jadwal_insert(&ht, &keys[i], &i);
         assert(rv == JADWAL_OK);
     }
     printf("insertion time: %f\n", timer_dt(&tm_tmp));
@@ -46,32 +84,98 @@ int main(void) {
 
     char keybuff[256];
     size_t keybuff_sz = 256;
-    const char *keycpy = keybuff;
+    jadwal_key_type keycpy;
 
     for (int i=0; i<nwords; i++) {
         int idx = xorshf96() % nwords;
         const char *key = words[idx];
-        assert(strlen(key) < keybuff_sz);
-        strcpy(keybuff, key);
+        size_t len = strlen(key);
+        assert(len < keybuff_sz);
+        memcpy(keybuff, key, len + 1);
+        keycpy = bench_key(keybuff, len);
         struct jadwal_iter iter;
         int rv = jadwal_find(&ht, &keycpy, &iter);
         assert(rv == JADWAL_OK);
-        assert(iter.pair->key == key);
-        assert(iter.pair->value == idx);
+        assert(bench_key_is(jadwal_iter_key(&iter), key));
+        assert(*jadwal_iter_value(&iter) == idx);
     }
     printf("lookup time:    %f\n", timer_dt(&tm_tmp));
     timer_begin(&tm_tmp);
+    xorshf96_srand(0xfeedbeef);
+
+    //the same lookups, BATCH at a time
+    static char batch_buff[BATCH][256];
+    jadwal_key_type batch_keys[BATCH];
+    int batch_idx[BATCH];
+    struct jadwal_iter batch_iters[BATCH];
+    for (int i=0; i<nwords; i+=BATCH) {
+        int n = nwords - i < BATCH ? nwords - i : BATCH;
+        for (int j=0; j<n; j++) {
+            batch_idx[j] = xorshf96() % nwords;
+            size_t len = strlen(words[batch_idx[j]]);
+            assert(len < keybuff_sz);
+            memcpy(batch_buff[j], words[batch_idx[j]], len + 1);
+            batch_keys[j] = bench_key(batch_buff[j], len);
+        }
+        int rv = jadwal_find_batch(&ht, batch_keys, n, batch_iters, NULL);
+        assert(rv == JADWAL_OK);
+        for (int j=0; j<n; j++) {
+            assert(bench_key_is(jadwal_iter_key(&batch_iters[j]), words[batch_idx[j]]));
+            assert(*jadwal_iter_value(&batch_iters[j]) == batch_idx[j]);
+        }
+    }
+    printf("batch lookup:   %f\n", timer_dt(&tm_tmp));
+
+    //counting random words into a second table, with a find and then an insert on a miss, and with
+    //jadwal_try_emplace() (one lookup)
+    for (int with_emplace=0; with_emplace<2; with_emplace++) {
+        struct jadwal counts;
+        rv = jadwal_init(&counts, 0);
+        assert(rv == JADWAL_OK);
+        xorshf96_srand(0xfeedbeef);
+        timer_begin(&tm_tmp);
+        for (int i=0; i<nwords; i++) {
+            jadwal_key_type key = keys[xorshf96() % nwords];
+            if (with_emplace) {
+                jadwal_value_type *count;
+                int rv = jadwal_try_emplace(&counts, &key, NULL, NULL, &count);
+                assert(rv == JADWAL_OK || rv == JADWAL_DUPLICATE_KEY);
+                ++*count;
+                continue;
+            }
+            struct jadwal_iter iter;
+            int rv = jadwal_find(&counts, &key, &iter);
+            if (rv == JADWAL_OK) {
+                ++*jadwal_iter_value(&iter);
+            }
+            else {
+                int one = 1;
+                rv = jadwal_insert(&counts, &key, &one);
+                assert(rv == JADWAL_OK);
+            }
+        }
+        printf(with_emplace ? "count emplace:  %f\n" : "count find+ins: %f\n", timer_dt(&tm_tmp));
+        jadwal_deinit(&counts);
+    }
+    timer_begin(&tm_tmp);
     for (int i=nwords-1; i>=0; i--) {
         const char *key = words[i];
-        assert(strlen(key) < keybuff_sz);
-        strcpy(keybuff, key);
+        size_t len = strlen(key);
+        assert(len < keybuff_sz);
+        memcpy(keybuff, key, len + 1);
+        keycpy = bench_key(keybuff, len);
 
         int rv = jadwal_remove(&ht, &keycpy);
         assert(rv == JADWAL_OK);
     }
     printf("deletion time:  %f\n", timer_dt(&tm_tmp));
     printf("total time:     %f\n", timer_dt(&tm_init));
+#ifdef JADWAL_STATS
+    printf("avg probe len:  %f\n", ht.stats.nlookups ? (double) ht.stats.nprobes / ht.stats.nlookups : 0.0);
+    printf("max probe len:  %ld\n", ht.stats.max_probe_len);
+#endif
     printf("success\n");
     jadwal_deinit(&ht);
+    free(keys);
 }
 
@@ -25,6 +25,8 @@ parser.add_argument('--mode', nargs=1, help='["values", "funcs", "switch", "swit
 parser.add_argument('--no-values', help='disable printing the array', action='store_true')
 parser.add_argument('--no-ifndef', help='disable printing ifndef guard', action='store_true')
 parser.add_argument('--decl-modifier', nargs=1, help='defaults to static')
+parser.add_argument('--fastmod', help='also print the fastmod multipliers and function (needs __SIZEOF_INT128__ to be usable)', action='store_true')
+parser.add_argument('--values', nargs=1, help='comma separated primes to use instead of generating them (doesn\'t need ./gen_primes)')
 with_values = True
 with_ifndef = True
 decl_modifier = 'static '
@@ -61,6 +63,11 @@ if args['mode']:
     mode = args['mode'][0]
 
 def gen():
+    if args['values']:
+        lis = [int(v) for v in args['values'][0].split(',') if int(v) > 0]
+        for i,v in enumerate(lis):
+            assert(v.bit_length() == i + 2)
+        return lis
     bitl = 2
     lis = []
     for n in range(bitl, bits):
@@ -167,6 +174,30 @@ def mode_values(values):
 
     print('\n};')
 
+def mode_fastmod(values):
+    #lemire's fastmod, M = floor((2^128 - 1) / d) + 1, then n % d == ((M * n mod 2^128) * d) >> 128 for any 64 bit n
+    values = list(values)
+    #have array[0] and array[1] = 0 (a sentinel)
+    ms = [0, 0, *[((1 << 128) - 1) // v + 1 for v in values]]
+    mask = (1 << 64) - 1
+    print('/*multipliers for {pfx}_fastmod(), M = floor((2^128 - 1) / {pfx}_values[power]) + 1, split into 64 bit halves*/'.format(pfx=prefix))
+    for half, shift in (('hi', 64), ('lo', 0)):
+        print('{modifier}const uint64_t {pfx}_fastmod_m_{half}[] = {{'.format(pfx=prefix, half=half, modifier=decl_modifier))
+        for i in range(0, len(ms), 3):
+            print('    ' + ', '.join('0x{:016X}LLU'.format((m >> shift) & mask) for m in ms[i:i+3]) + ',')
+        print('};')
+    print('''#ifdef __SIZEOF_INT128__
+/*returns n % {pfx}_values[power] for any 64 bit n without a division (lemire et al. "faster remainder by direct computation")*/
+{modifier}uint64_t {pfx}_fastmod(uint64_t n, int power) {{
+    __uint128_t m = ((__uint128_t) {pfx}_fastmod_m_hi[power] << 64) | {pfx}_fastmod_m_lo[power];
+    __uint128_t lowbits = m * n;
+    uint64_t d = {pfx}_values[power];
+    __uint128_t bottom_half = ((lowbits & UINT64_MAX) * d) >> 64;
+    __uint128_t top_half = (lowbits >> 64) * d;
+    return (uint64_t) ((bottom_half + top_half) >> 64);
+}}
+#endif'''.format(pfx=prefix, modifier=decl_modifier))
+
 def ifndefbegin():
     if with_ifndef:
         print('''#ifndef {pfx}_H\n#define {pfx}_H\n#include <stdint.h>\n'''.format(pfx=prefix.upper()))
@@ -186,4 +217,7 @@ elif mode == 'switch':
 elif mode == 'switch_p':
     mode_switch_p(generated)
 
+if args['fastmod']:
+    mode_fastmod(generated)
+
 ifndefend()
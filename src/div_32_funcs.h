@@ -89,4 +89,43 @@ adiv_fptr const adiv_funcs[] = {
     adiv_mod_0,
 };
 
+/*multipliers for adiv_fastmod(), M = floor((2^128 - 1) / adiv_values[power]) + 1, split into 64 bit halves*/
+static const uint64_t adiv_fastmod_m_hi[] = {
+    0x0000000000000000LLU, 0x0000000000000000LLU, 0x8000000000000000LLU,
+    0x2492492492492492LLU, 0x13B13B13B13B13B1LLU, 0x0B21642C8590B216LLU,
+    0x04325C53EF368EB0LLU, 0x027C45979C95204FLLU, 0x0105197F7D734041LLU,
+    0x00824A4E60B3262BLLU, 0x0042AB5C73A13458LLU, 0x00225DB37B5E5F4FLLU,
+    0x001475F82AD6FF99LLU, 0x0009D77AD449F777LLU, 0x00040A29908FA966LLU,
+    0x00028918E3CD5432LLU, 0x000127564DC142BCLLU, 0x0000A65CF1D1418ELLU,
+    0x00004AB48714548ELLU, 0x000025C95F1E12DFLLU, 0x000013A07CDCDE5ALLU,
+    0x00000947373CEF59LLU, 0x00000438D32213A1LLU, 0x0000022983E30402LLU,
+    0x00000101A64D2CB4LLU, 0x00000095D0E39267LLU, 0x0000004441E767FELLU,
+    0x000000241AACEE9ALLU, 0x00000012989DEAAFLLU, 0x0000000A86B486CBLLU,
+    0x000000045218A63ALLU, 0x0000000201EEBBE4LLU,
+};
+static const uint64_t adiv_fastmod_m_lo[] = {
+    0x0000000000000000LLU, 0x0000000000000000LLU, 0x0000000000000000LLU,
+    0x4924924924924925LLU, 0x3B13B13B13B13B14LLU, 0x42C8590B21642C86LLU,
+    0x4325C53EF368EB05LLU, 0x88B2F392A409F117LLU, 0x465FDF5CD0105198LLU,
+    0xC4F6547C2ED2B42BLLU, 0x8B96C99219859965LLU, 0xDFC827BC5786A51FLLU,
+    0xB22729CD01FF853DLLU, 0x237BE7DB66AF3A8DLLU, 0x24F4F8408247BC77LLU,
+    0x9784A15CF4017743LLU, 0x8F77F0AD8DC75142LLU, 0x862646864AAADB31LLU,
+    0xFEB55F062B05C323LLU, 0xAAD0677153B3840BLLU, 0xA0134A9EBA980DD4LLU,
+    0x944E8556160C8B58LLU, 0xE4F7D35EAF60CF28LLU, 0xEB9A85EA3701BFA1LLU,
+    0x4ACE302E1639EC17LLU, 0xF813DEB3C03FD580LLU, 0xBC95DC97793C63CFLLU,
+    0xE72A9BA6947893E8LLU, 0xCCAB0C5ED720E695LLU, 0x8F308FABF64BAE8CLLU,
+    0x6B636F28C09FC32ALLU, 0xA706C67FB255914ELLU,
+};
+#ifdef __SIZEOF_INT128__
+/*returns n % adiv_values[power] for any 64 bit n without a division (lemire et al. "faster remainder by direct computation")*/
+static uint64_t adiv_fastmod(uint64_t n, int power) {
+    __uint128_t m = ((__uint128_t) adiv_fastmod_m_hi[power] << 64) | adiv_fastmod_m_lo[power];
+    __uint128_t lowbits = m * n;
+    uint64_t d = adiv_values[power];
+    __uint128_t bottom_half = ((lowbits & UINT64_MAX) * d) >> 64;
+    __uint128_t top_half = (lowbits >> 64) * d;
+    return (uint64_t) ((bottom_half + top_half) >> 64);
+}
+#endif
+
 #endif /*ADIV_H*/
@@ -38,8 +38,9 @@ needed functions that should be defined before including this:
     size_t jadwal_hash(void *udata, jadwal_key_type *key)
 
     udata is in struct jadwal, you're supposed to set it directly when you initialize the hashtable
+    (with JADWAL_STR_KEYS both are provided)
 needed typedefs: 
-     typedef <type> jadwal_key_type; 
+     typedef <type> jadwal_key_type; (not with JADWAL_STR_KEYS)
      typedef <type> jadwal_value_type; 
 
     as an example: key_type can be a string (char *)
@@ -48,6 +49,86 @@ needed typedefs:
                      the function jadwal would recieve struct foo *
                      the same is true for the api's functions, insert() expects (key: char **, value: struct foo *)
                                                                remove() would expect (key: char **)
+
+optional defines (compile time):
+    JADWAL_DBG            assertions and sanity checks
+    JADWAL_DATA_ARG       pass udata to jadwal_hash() and jadwal_key_eq_cmp() (see above)
+    JADWAL_GROUP_PROBE    keep a control byte per bucket (state + 7 bit partial hash) in a separate array, and probe
+                          a group of buckets at once (32 with AVX2, 16 with SSE2, 8 otherwise)
+    JADWAL_NO_SIMD        with JADWAL_GROUP_PROBE, use the portable scalar group implementation
+    JADWAL_SOA            store pair_data (or the control bytes), keys and values in three separate arrays,
+                          iterators don't have a pair member then, use jadwal_iter_key() / jadwal_iter_value()
+    JADWAL_ROBIN_HOOD     robin hood insertion with backward shift deletion (no tombstones), the probe distance of each
+                          bucket is kept in pair_data, this allows higher load factors (the defaults become 30 / 85),
+                          removing elements while iterating is not supported in this mode
+    JADWAL_RH_MAX_DIST    with JADWAL_ROBIN_HOOD, the table grows instead of storing a probe distance above this (max 255)
+    JADWAL_POW2           power of two bucket counts instead of primes, the hash is folded into a bucket index with a
+                          multiply and a shift (fibonacci hashing) instead of a division
+    JADWAL_PROBE_TRIANGULAR
+                          probe at offsets 1, 3, 6, 10, ... from the first bucket instead of linearly, needs JADWAL_POW2
+    JADWAL_PROBE_DOUBLE_HASH
+                          probe with a per key step taken from the upper bits of the (remixed) hash
+                          with either of the two, removed elements always leave a tombstone behind
+    JADWAL_HOPSCOTCH      hopscotch hashing, every bucket has a bitmap of the buckets (up to JADWAL_HOP_RANGE away) that hold
+                          keys which hash to it, lookups only look at those, removal doesn't leave tombstones,
+                          the defaults become 30 / 85 like with JADWAL_ROBIN_HOOD
+    JADWAL_HOP_RANGE      with JADWAL_HOPSCOTCH, the neighbourhood size, 32 (default) or 64
+    JADWAL_STORE_HASH     keep the full hash of every key next to it, resizing then moves elements without calling
+                          jadwal_hash() (costs a size_t per bucket)
+    JADWAL_REHASH_BATCH   how many elements resizing hashes (and prefetches the destination of) ahead of placing them,
+                          16 by default, 1 turns the look ahead off
+    JADWAL_FIND_BATCH     how many lookups jadwal_find_batch() keeps in flight, 16 by default
+    JADWAL_INSERT_BATCH   how many keys jadwal_insert_batch() sorts by bucket at a time, 4096 by default
+    JADWAL_PREFETCH_KEY(key)
+                          prefetches the memory a stored key points to (key is a jadwal_key_type *), for example
+                          __builtin_prefetch(*(key)) for string keys, jadwal_find_batch() then runs it on the likely
+                          match of every lookup before any key is compared
+    JADWAL_STR_KEYS       jadwal_key_type is struct jadwal_str, a pointer and a length (make one with jadwal_str_make()
+                          or jadwal_str_from_cstr()), jadwal_hash() and jadwal_key_eq_cmp() are provided, the lengths are
+                          compared before the strings (with memcmp())
+    JADWAL_STR_HASH(ptr, len)
+                          with JADWAL_STR_KEYS, hashes len bytes at ptr, jadwal_str_hash_bytes() if it isn't defined
+    JADWAL_STR_PREFIX     with JADWAL_STR_KEYS, also keep the first 8 bytes in the key and compare them before the
+                          strings (8 more bytes per bucket, the partial hash in pair_data already rejects most mismatches)
+    JADWAL_STR_INLINE     with JADWAL_STR_KEYS, strings up to JADWAL_STR_INLINE_MAX (24 by default, at least 16) bytes
+                          are copied into the key (the bucket) instead of pointed to, longer ones keep their beginning
+                          there next to the pointer, use jadwal_str_data() for the bytes of a key
+    JADWAL_ARENA          every table gets an arena, memory from jadwal_arena_alloc() is cut out of big chunks allocated
+                          with its memfuncs, jadwal_arena_free() puts a block on a free list of its size class for the
+                          next allocation of that size and jadwal_deinit() frees all of it at once, with JADWAL_STR_KEYS
+                          jadwal_insert_copy() keeps a copy of the key there (see jadwal_str_copy()), jadwal_remove_copy()
+                          gives it back
+    JADWAL_ARENA_CHUNK, JADWAL_ARENA_MAX_SMALL
+                          with JADWAL_ARENA, the chunk size (65536 by default) and the biggest block that is taken from a
+                          chunk (256 by default, bigger ones are allocated one by one)
+    JADWAL_NO_PREFETCH    don't emit prefetch hints (they're only emitted with gcc / clang)
+    JADWAL_INCREMENTAL    grow incrementally: the old buckets stay around next to the new ones and every insert and remove
+                          moves JADWAL_MIGRATE_STEP (32 by default) of them over, a key that is still in the old buckets
+                          is looked up there and moved first, jadwal_maintenance() moves more when idle, beginning an
+                          iterator finishes the move (all of these invalidate iterators and value pointers like an insert
+                          does), lookups don't move anything: a key that isn't in the new buckets is looked up in the old
+                          ones and the iterator points there, use jadwal_count() instead of ht->nelements
+    JADWAL_PARALLEL_RESIZE
+                          resizing a big table (JADWAL_PARALLEL_MIN elements, 65536 by default) splits the old buckets
+                          into ranges that are moved by the tasks of a runner set with jadwal_set_task_runner(), each
+                          claims buckets in the new table with atomic compare and swaps (gcc / clang __atomic builtins),
+                          jadwal_hash() is then called from those tasks, not available with JADWAL_ROBIN_HOOD or
+                          JADWAL_HOPSCOTCH (their inserts move other elements), jadwal_build_from() fills a fresh table
+                          with those tasks too
+    JADWAL_PTHREADS       with JADWAL_PARALLEL_RESIZE, provide jadwal_run_tasks_pthreads(), a runner that starts a thread
+                          per task (link with -pthread)
+    JADWAL_MANUAL_RESIZE  inserts never grow the table or purge tombstones, they fail with JADWAL_FAILED_AT_RESIZE
+                          instead of taking one of the last two empty buckets, the caller calls jadwal_resize__() and
+                          jadwal_purge_tombstones__() itself (jadwal_concurrent.h does that), not available with
+                          JADWAL_ROBIN_HOOD, JADWAL_HOPSCOTCH or JADWAL_INCREMENTAL
+    JADWAL_STATS          count probe lengths in ht->stats (see struct jadwal_stats)
+    JADWAL_NO_FASTMOD     with prime bucket counts, use the % operator instead of the precomputed reciprocals in
+                          div_32_funcs.h (those are only used where the compiler has __uint128_t)
+    JADWAL_DEFAULT_SHRINK_AT, JADWAL_DEFAULT_GROW_AT
+                          percentages used by jadwal_init() and jadwal_init_with_udata()
+    JADWAL_DEFAULT_PURGE_AT
+                          when tombstones (deleted buckets) take more than this percentage of the buckets, the next insert
+                          rehashes the table in place to get rid of them, 20 by default, see jadwal_set_purge_at()
 */
 
 
@@ -63,6 +144,195 @@ needed typedefs:
 #include <string.h> //memset, memcpy, ...
 #include "div_32_funcs.h" //divison functions
 
+#ifdef JADWAL_STR_KEYS
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "JADWAL_STR_KEYS loads the bytes of a string as little endian words"
+#endif
+//the last r (< 8) bytes before end as a zero padded word, without reading outside of [start, end)
+static uint64_t jadwal_str_load_tail__(const char *start, const char *end, size_t r) {
+    uint64_t word = 0;
+    if (r == 0)
+        return 0;
+    if (end - start >= 8) {
+        memcpy(&word, end - 8, 8);
+        return word >> (8 * (8 - r));
+    }
+    //the whole string is r bytes
+    if (r >= 4) {
+        uint32_t lo, hi;
+        memcpy(&lo, start, 4);
+        memcpy(&hi, end - 4, 4);
+        return lo | ((uint64_t) hi << (8 * (r - 4)));
+    }
+    return (uint64_t) (unsigned char) start[0] | (uint64_t) (unsigned char) start[r / 2] << (8 * (r / 2)) |
+           (uint64_t) (unsigned char) start[r - 1] << (8 * (r - 1));
+}
+
+#ifdef JADWAL_STR_INLINE
+#ifndef JADWAL_STR_INLINE_MAX
+#define JADWAL_STR_INLINE_MAX 24
+#endif
+#if JADWAL_STR_INLINE_MAX < 16 || JADWAL_STR_INLINE_MAX % 8 != 0
+#error "JADWAL_STR_INLINE_MAX must be a multiple of 8, at least 16 (a pointer and some bytes of a longer string)"
+#endif
+#ifdef JADWAL_STR_PREFIX
+#error "with JADWAL_STR_INLINE the bytes next to the pointer of a long key already hold its beginning"
+#endif
+//a string key of up to JADWAL_STR_INLINE_MAX bytes is copied into the key itself, so into the bucket, comparing and
+//hashing it never leaves the table and the bytes passed to jadwal_str_make() don't have to outlive it
+//a longer one points to its bytes (which the table doesn't copy), the rest of the inline space keeps its beginning
+struct jadwal_str {
+    size_t len;
+    union {
+        char bytes[JADWAL_STR_INLINE_MAX]; //len <= JADWAL_STR_INLINE_MAX
+        uint64_t words[JADWAL_STR_INLINE_MAX / 8];
+        struct {
+            const char *ptr;
+            char prefix[JADWAL_STR_INLINE_MAX - sizeof(const char *)];
+        } ext;
+    } u;
+};
+typedef struct jadwal_str jadwal_key_type;
+
+//the bytes of the string, inline ones are inside the key (in the bucket for stored keys, until they move)
+static const char *jadwal_str_data(const struct jadwal_str *str) {
+    return str->len <= JADWAL_STR_INLINE_MAX ? str->u.bytes : str->u.ext.ptr;
+}
+static struct jadwal_str jadwal_str_make(const char *ptr, size_t len) {
+    struct jadwal_str str;
+    str.len = len;
+    if (len > JADWAL_STR_INLINE_MAX) {
+        str.u.ext.ptr = ptr;
+        memcpy(str.u.ext.prefix, ptr, sizeof str.u.ext.prefix);
+        return str;
+    }
+    //zero padded (the bytes past len are compared and hashed too), a word at a time, hashing the key right after
+    //reads the same words back, byte sized stores would make those loads wait
+    for (size_t at = 0; at < JADWAL_STR_INLINE_MAX; at += 8) {
+        uint64_t word = 0;
+        if (at + 8 <= len)
+            memcpy(&word, ptr + at, 8);
+        else if (at < len)
+            word = jadwal_str_load_tail__(ptr, ptr + len, len - at);
+        str.u.words[at / 8] = word;
+    }
+    return str;
+}
+#else
+//a string key, the bytes don't have to be NUL terminated (a slice of a bigger buffer works), the table doesn't copy them
+//the length (and with JADWAL_STR_PREFIX the first 8 bytes) are in the key itself, so in the bucket, a comparison with a
+//key of another length (or another beginning) never reads the string
+struct jadwal_str {
+    const char *ptr;
+    size_t len;
+#ifdef JADWAL_STR_PREFIX
+    uint64_t prefix; //the first min(len, 8) bytes, zero padded
+#endif
+};
+typedef struct jadwal_str jadwal_key_type;
+
+static struct jadwal_str jadwal_str_make(const char *ptr, size_t len) {
+    struct jadwal_str str;
+    str.ptr = ptr;
+    str.len = len;
+#ifdef JADWAL_STR_PREFIX
+    str.prefix = 0;
+    if (len)
+        memcpy(&str.prefix, ptr, len < 8 ? len : 8);
+#endif
+    return str;
+}
+static const char *jadwal_str_data(const struct jadwal_str *str) {
+    return str->ptr;
+}
+#endif // JADWAL_STR_INLINE
+static struct jadwal_str jadwal_str_from_cstr(const char *cstr) {
+    return jadwal_str_make(cstr, strlen(cstr));
+}
+
+//8 bytes at a time, each word is mixed in with a multiply and a xor shift (the constants are from splitmix64), the
+//last one zero padded (zero_padded says the bytes after ptr + len up to the next multiple of 8 are there and zero)
+static size_t jadwal_str_hash_bytes__(const char *ptr, size_t len, bool zero_padded) {
+    const char *start = ptr;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    for (; len >= 8; ptr += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, ptr, 8);
+        h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    uint64_t tail = 0;
+    if (len && zero_padded)
+        memcpy(&tail, ptr, 8);
+    else
+        tail = jadwal_str_load_tail__(start, ptr + len, len);
+    h = (h ^ tail) * 0x94D049BB133111EBULL;
+    return (size_t) (h ^ (h >> 29));
+}
+static size_t jadwal_str_hash_bytes(const char *ptr, size_t len) {
+    return jadwal_str_hash_bytes__(ptr, len, false);
+}
+
+static size_t jadwal_str_hash__(jadwal_key_type *key) {
+#ifdef JADWAL_STR_HASH
+    return JADWAL_STR_HASH(jadwal_str_data(key), key->len);
+#else
+#ifdef JADWAL_STR_INLINE
+    if (key->len <= JADWAL_STR_INLINE_MAX)
+        return jadwal_str_hash_bytes__(key->u.bytes, key->len, true);
+#endif
+    return jadwal_str_hash_bytes(jadwal_str_data(key), key->len);
+#endif
+}
+#ifdef JADWAL_STR_INLINE
+static int jadwal_str_eq_cmp__(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    if (key_1->len != key_2->len)
+        return 1;
+    if (key_1->len <= JADWAL_STR_INLINE_MAX) //zero padded, a fixed size compare doesn't need a call to memcmp()
+        return memcmp(key_1->u.bytes, key_2->u.bytes, JADWAL_STR_INLINE_MAX) != 0;
+    const size_t nprefix = sizeof key_1->u.ext.prefix;
+    if (memcmp(key_1->u.ext.prefix, key_2->u.ext.prefix, nprefix) != 0)
+        return 1;
+    if (key_1->u.ext.ptr == key_2->u.ext.ptr)
+        return 0;
+    return memcmp(key_1->u.ext.ptr + nprefix, key_2->u.ext.ptr + nprefix, key_1->len - nprefix) != 0;
+}
+#else
+static int jadwal_str_eq_cmp__(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    if (key_1->len != key_2->len)
+        return 1;
+    if (key_1->ptr == key_2->ptr || key_1->len == 0)
+        return 0;
+#ifdef JADWAL_STR_PREFIX
+    if (key_1->prefix != key_2->prefix)
+        return 1;
+    if (key_1->len <= 8)
+        return 0;
+    return memcmp(key_1->ptr + 8, key_2->ptr + 8, key_1->len - 8) != 0;
+#else
+    return memcmp(key_1->ptr, key_2->ptr, key_1->len) != 0;
+#endif
+}
+#endif // JADWAL_STR_INLINE
+#ifdef JADWAL_DATA_ARG
+static size_t jadwal_hash(void *udata, jadwal_key_type *key) {
+    (void) udata;
+    return jadwal_str_hash__(key);
+}
+static int jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    (void) udata;
+    return jadwal_str_eq_cmp__(key_1, key_2);
+}
+#else
+static size_t jadwal_hash(jadwal_key_type *key) {
+    return jadwal_str_hash__(key);
+}
+static int jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return jadwal_str_eq_cmp__(key_1, key_2);
+}
+#endif
+#endif // JADWAL_STR_KEYS
+
 
 static const uint32_t jprimes_n_values = 32;
 static const uint32_t jprimes_values[] = {
@@ -81,9 +351,131 @@ static int jadwal_get_jprimes_power_idx(size_t at_least) {
     return -1; //error, must be handled
 }
 
+//the bucket count ladder, nbuckets_po2 is an index into it
+//by default it's the primes above, with JADWAL_POW2 it's the powers of two themselves
+#ifdef JADWAL_POW2
+static const uint32_t jadwal_n_size_classes = 31; //1 << 30 is the biggest that fits in a 32 bit long
+static long jadwal_size_class_nbuckets(long size_class) {
+    return 1L << size_class;
+}
+static int jadwal_get_size_class(size_t at_least) {
+    //starts at 2
+    for (int i=2; i < (int)jadwal_n_size_classes; i++) {
+        if (((size_t) 1 << i) >= at_least) 
+            return i;
+    }
+    return -1; //error, must be handled
+}
+#else
+static const uint32_t jadwal_n_size_classes = 32;
+static long jadwal_size_class_nbuckets(long size_class) {
+    return jprimes_values[size_class];
+}
+static int jadwal_get_size_class(size_t at_least) {
+    return jadwal_get_jprimes_power_idx(at_least);
+}
+#endif
+
 
 #define JADWAL_MIN_TABLESIZE 4
 
+#if defined(JADWAL_ROBIN_HOOD) && defined(JADWAL_GROUP_PROBE)
+    #error "JADWAL_ROBIN_HOOD keeps the probe distance in pair_data, which doesn't exist with JADWAL_GROUP_PROBE"
+#endif
+
+#if defined(JADWAL_PROBE_TRIANGULAR) && defined(JADWAL_PROBE_DOUBLE_HASH)
+    #error "only one of JADWAL_PROBE_TRIANGULAR and JADWAL_PROBE_DOUBLE_HASH can be defined"
+#endif
+#if defined(JADWAL_PROBE_TRIANGULAR) || defined(JADWAL_PROBE_DOUBLE_HASH)
+    #define JADWAL_PROBE_NONLINEAR
+    #if defined(JADWAL_GROUP_PROBE) || defined(JADWAL_ROBIN_HOOD)
+        #error "JADWAL_GROUP_PROBE and JADWAL_ROBIN_HOOD only work with linear probing"
+    #endif
+#endif
+#if defined(JADWAL_PROBE_TRIANGULAR) && !defined(JADWAL_POW2)
+    #error "triangular probing only visits every bucket when the bucket count is a power of two, define JADWAL_POW2"
+#endif
+
+#ifdef JADWAL_HOPSCOTCH
+    #if defined(JADWAL_GROUP_PROBE) || defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_PROBE_NONLINEAR)
+        #error "JADWAL_HOPSCOTCH can't be combined with JADWAL_GROUP_PROBE, JADWAL_ROBIN_HOOD or a non linear probe sequence"
+    #endif
+    #ifndef JADWAL_HOP_RANGE
+        #define JADWAL_HOP_RANGE 32
+    #endif
+    #if JADWAL_HOP_RANGE != 32 && JADWAL_HOP_RANGE != 64
+        #error "JADWAL_HOP_RANGE must be 32 or 64"
+    #endif
+#endif
+
+#ifdef JADWAL_ROBIN_HOOD
+    #ifndef JADWAL_RH_MAX_DIST
+        #define JADWAL_RH_MAX_DIST 255
+    #endif
+    #if JADWAL_RH_MAX_DIST > 255 || JADWAL_RH_MAX_DIST < 1
+        #error "JADWAL_RH_MAX_DIST must be in [1, 255], it is stored in 8 bits"
+    #endif
+#endif
+
+#ifndef JADWAL_DEFAULT_GROW_AT
+    #if defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_HOPSCOTCH)
+        #define JADWAL_DEFAULT_SHRINK_AT 30
+        #define JADWAL_DEFAULT_GROW_AT   85
+    #else
+        #define JADWAL_DEFAULT_SHRINK_AT 20
+        #define JADWAL_DEFAULT_GROW_AT   60
+    #endif
+#endif
+
+#ifdef JADWAL_PARALLEL_RESIZE
+    #if defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_HOPSCOTCH)
+        #error "JADWAL_PARALLEL_RESIZE can't be combined with JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH"
+    #endif
+    #ifndef __GNUC__
+        #error "JADWAL_PARALLEL_RESIZE uses the __atomic builtins of gcc / clang"
+    #endif
+    #ifndef JADWAL_PARALLEL_MIN
+        #define JADWAL_PARALLEL_MIN 65536
+    #endif
+    #define JADWAL_MAX_TASKS 256
+#endif
+
+#ifdef JADWAL_INCREMENTAL
+    #ifndef JADWAL_MIGRATE_STEP
+        #define JADWAL_MIGRATE_STEP 32
+    #endif
+    #if JADWAL_MIGRATE_STEP < 8
+        #error "JADWAL_MIGRATE_STEP must be at least 8, otherwise the new buckets can fill up before the old ones are moved"
+    #endif
+#endif
+
+#ifdef JADWAL_MANUAL_RESIZE
+    #if defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_HOPSCOTCH) || defined(JADWAL_INCREMENTAL)
+        #error "JADWAL_MANUAL_RESIZE can't be combined with JADWAL_ROBIN_HOOD, JADWAL_HOPSCOTCH or JADWAL_INCREMENTAL"
+    #endif
+#endif
+
+#ifndef JADWAL_DEFAULT_PURGE_AT
+    #define JADWAL_DEFAULT_PURGE_AT 20
+#endif
+
+#ifdef JADWAL_ARENA
+    #ifndef JADWAL_ARENA_CHUNK
+        #define JADWAL_ARENA_CHUNK 65536
+    #endif
+    #ifndef JADWAL_ARENA_MAX_SMALL
+        #define JADWAL_ARENA_MAX_SMALL 256
+    #endif
+    #define JADWAL_ARENA_ALIGN 16
+    #if JADWAL_ARENA_MAX_SMALL < JADWAL_ARENA_ALIGN || JADWAL_ARENA_MAX_SMALL % JADWAL_ARENA_ALIGN != 0
+        #error "JADWAL_ARENA_MAX_SMALL must be a multiple of 16"
+    #endif
+    #if JADWAL_ARENA_CHUNK < 4 * JADWAL_ARENA_MAX_SMALL || JADWAL_ARENA_CHUNK % JADWAL_ARENA_ALIGN != 0
+        #error "JADWAL_ARENA_CHUNK must be a multiple of 16, and at least 4 times JADWAL_ARENA_MAX_SMALL"
+    #endif
+    #define JADWAL_ARENA_NCLASSES (JADWAL_ARENA_MAX_SMALL / JADWAL_ARENA_ALIGN)
+#endif
+
 #ifdef JADWAL_DBG
     #include <assert.h>
     #define JADWAL_DBG_CODE(...) do { __VA_ARGS__ } while(0)
@@ -100,37 +492,149 @@ static int jadwal_get_jprimes_power_idx(size_t at_least) {
 //long is used for all lengths / sizes
 
 
+#ifdef JADWAL_GROUP_PROBE
+//control bytes, one per bucket, kept in a separate array (ht->ctrl) so that a probe can look at a whole group of buckets at once
+//like pair_data flags, logic is chosen so that memsetting with 0 means empty:
+//  0000 0000   empty
+//  0000 0001   deleted
+//  1xxx xxxx   occupied, the lower 7 bits are a partial hash (tag)
+//in this mode struct jadwal_pair_type has no pair_data, the control byte replaces it
+#define JADWAL_CTRL_EMPTY    0x00U
+#define JADWAL_CTRL_DELETED  0x01U
+#define JADWAL_CTRL_OCCUPIED 0x80U
+
+//the group width is picked at compile time, define JADWAL_NO_SIMD to force the scalar fallback
+#if defined(__AVX2__) && !defined(JADWAL_NO_SIMD)
+    #include <immintrin.h>
+    #define JADWAL_GROUP_WIDTH 32
+    #define JADWAL_GROUP_SHIFT 0 //bit i of a group mask is bucket i
+#elif defined(__SSE2__) && !defined(JADWAL_NO_SIMD)
+    #include <emmintrin.h>
+    #define JADWAL_GROUP_WIDTH 16
+    #define JADWAL_GROUP_SHIFT 0
+#else
+    #define JADWAL_GROUP_WIDTH 8
+    #define JADWAL_GROUP_SHIFT 3 //bit (8*i + 7) of a group mask is bucket i
+#endif
+typedef uint64_t jadwal_group_mask;
+
+static unsigned char jadwal_hash_to_ctrl_tag(size_t full_hash) {
+    return JADWAL_CTRL_OCCUPIED | (full_hash & 0x7F);
+}
+
+#if JADWAL_GROUP_WIDTH == 32
+//returns a mask of the buckets in the group whose control byte equals ctrl
+static jadwal_group_mask jadwal_group_match(const unsigned char *group, unsigned char ctrl) {
+    __m256i grp = _mm256_loadu_si256((const __m256i *) group);
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(grp, _mm256_set1_epi8((char) ctrl)));
+}
+//returns a mask of the buckets in the group that are not occupied (empty or deleted)
+static jadwal_group_mask jadwal_group_match_free(const unsigned char *group) {
+    __m256i grp = _mm256_loadu_si256((const __m256i *) group);
+    return (uint32_t) ~_mm256_movemask_epi8(grp);
+}
+#elif JADWAL_GROUP_WIDTH == 16
+static jadwal_group_mask jadwal_group_match(const unsigned char *group, unsigned char ctrl) {
+    __m128i grp = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(grp, _mm_set1_epi8((char) ctrl)));
+}
+static jadwal_group_mask jadwal_group_match_free(const unsigned char *group) {
+    __m128i grp = _mm_loadu_si128((const __m128i *) group);
+    return (~ (uint32_t) _mm_movemask_epi8(grp)) & 0xFFFFU;
+}
+#else
+//scalar fallback, the 8 control bytes are handled as one uint64_t
+static uint64_t jadwal_group_load__(const unsigned char *group) {
+    uint64_t word = 0;
+    for (int i=0; i<8; i++)
+        word |= ((uint64_t) group[i]) << (8 * i); //byte order doesn't depend on the platform
+    return word;
+}
+static jadwal_group_mask jadwal_group_match(const unsigned char *group, unsigned char ctrl) {
+    const uint64_t lsbs = 0x0101010101010101ULL;
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t word = jadwal_group_load__(group) ^ (lsbs * ctrl);
+    //exact zero byte test (no false positives), sets the high bit of every byte that is zero
+    return ~(((word & low7) + low7) | word | low7);
+}
+static jadwal_group_mask jadwal_group_match_free(const unsigned char *group) {
+    return ~jadwal_group_load__(group) & 0x8080808080808080ULL;
+}
+#endif
+
+//index within the group of the first bucket set in mask, mask must not be 0
+static long jadwal_group_mask_first(jadwal_group_mask mask) {
+#ifdef __GNUC__
+    return __builtin_ctzll(mask) >> JADWAL_GROUP_SHIFT;
+#else
+    long i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i >> JADWAL_GROUP_SHIFT;
+#endif
+}
+#endif // JADWAL_GROUP_PROBE
+
+#ifndef JADWAL_SOA
+//bucket layout, when JADWAL_SOA is defined the three parts are kept in separate arrays instead (see struct jadwal)
 struct jadwal_pair_type {
+#ifndef JADWAL_GROUP_PROBE
     //bits:
     //[0...8]  flags
     //[8..32]  partial hash
+    //with JADWAL_ROBIN_HOOD:
+    //[0...8]   flags
+    //[8..16]   probe distance (how many buckets away from the one its hash maps to)
+    //[16..32]  partial hash
     unsigned int pair_data; //this is two parts: the flags, and the partial hash
+#endif
+#ifdef JADWAL_STORE_HASH
+    size_t hash; //what jadwal_hash() returned for key
+#endif
     jadwal_key_type   key;
     jadwal_value_type value;
 };
+#endif // JADWAL_SOA
 
-//pair type functions
-static unsigned char jadwal_pair_flags(struct jadwal_pair_type *prt) {
-    return prt->pair_data & 0xFF;
+#ifndef JADWAL_GROUP_PROBE
+#ifdef JADWAL_ROBIN_HOOD
+    #define JADWAL_PARTIAL_HASH_SHIFT 16
+#else
+    #define JADWAL_PARTIAL_HASH_SHIFT 8
+#endif
+//pair type functions, these work on the pair_data word of a bucket
+static unsigned char jadwal_pair_flags(unsigned int *pair_data) {
+    return *pair_data & 0xFF;
 }
-static unsigned int jadwal_pair_get_partial_hash(struct jadwal_pair_type *prt) {
-    const unsigned int upper_24bits = 0xFFFFFF00;
-    return prt->pair_data & upper_24bits;
+static unsigned int jadwal_pair_get_partial_hash(unsigned int *pair_data) {
+    const unsigned int upper_bits = (0xFFFFFFFFU >> JADWAL_PARTIAL_HASH_SHIFT) << JADWAL_PARTIAL_HASH_SHIFT;
+    return *pair_data & upper_bits;
 }
 //partial hashes have the lower 8 bits equal to zero, (there we store flags)
 //this is assuming unsigned int is at least 32 bits, 
 //the alternative would be uint32_t stuff
 static unsigned int jadwal_hash_to_partial_hash(size_t full_hash) {
-    const unsigned int lower_24bits = 0x00FFFFFF;
-    return (full_hash & lower_24bits) << 8;
+    const unsigned int lower_bits = 0xFFFFFFFFU >> JADWAL_PARTIAL_HASH_SHIFT;
+    return (full_hash & lower_bits) << JADWAL_PARTIAL_HASH_SHIFT;
 }
 static unsigned int jadwal_pair_combine_flags_and_partial_hash(unsigned char flags, unsigned int partial_hash) {
     JADWAL_ASSERT((partial_hash & 0xFF) == 0, "invalid partial hash");
     return partial_hash | flags;
 }
-static void jadwal_pair_set_flags(struct jadwal_pair_type *prt, unsigned char flags) {
-    prt->pair_data = jadwal_pair_combine_flags_and_partial_hash(flags, jadwal_pair_get_partial_hash(prt));
+static void jadwal_pair_set_flags(unsigned int *pair_data, unsigned char flags) {
+    *pair_data = (*pair_data & ~0xFFU) | flags; //keeps the partial hash (and the probe distance)
+}
+#ifdef JADWAL_ROBIN_HOOD
+static long jadwal_pair_get_dist(unsigned int *pair_data) {
+    return (*pair_data >> 8) & 0xFF;
 }
+static void jadwal_pair_set_dist(unsigned int *pair_data, long dist) {
+    JADWAL_ASSERT(dist >= 0 && dist <= JADWAL_RH_MAX_DIST, "probe distance doesn't fit");
+    *pair_data = (*pair_data & ~0xFF00U) | ((unsigned int) dist << 8);
+}
+#endif
 
 
 //[is_deleted] [is_not_empty]
@@ -139,33 +643,42 @@ static void jadwal_pair_set_flags(struct jadwal_pair_type *prt, unsigned char fl
 //     1            0          invalid state
 //     1            1          deleted
 
-static bool jadwal_pair_is_empty(struct jadwal_pair_type *prt) {
-    return (! (jadwal_pair_flags(prt) & JADWAL_VLT_IS_NOT_EMPTY)); //false mean occupied or deleted
+static bool jadwal_pair_is_empty(unsigned int *pair_data) {
+    return (! (jadwal_pair_flags(pair_data) & JADWAL_VLT_IS_NOT_EMPTY)); //false mean occupied or deleted
 }
-static bool jadwal_pair_is_corrupt(struct jadwal_pair_type *prt) {
+static bool jadwal_pair_is_corrupt(unsigned int *pair_data) {
     const unsigned char deleted_and_empty_mask = (JADWAL_VLT_IS_DELETED | JADWAL_VLT_IS_NOT_EMPTY); 
     const unsigned char deleted_and_empty      = (JADWAL_VLT_IS_DELETED | 0); //invalid state
-    return   (jadwal_pair_flags(prt) & JADWAL_VLT_IS_CORRUPT) || 
-             ((jadwal_pair_flags(prt) & deleted_and_empty_mask) == deleted_and_empty);
+    return   (jadwal_pair_flags(pair_data) & JADWAL_VLT_IS_CORRUPT) || 
+             ((jadwal_pair_flags(pair_data) & deleted_and_empty_mask) == deleted_and_empty);
 }
-static bool jadwal_pair_is_deleted(struct jadwal_pair_type *prt) {
-    return   (jadwal_pair_flags(prt) & JADWAL_VLT_IS_DELETED); //false means occupied or empty
+static bool jadwal_pair_is_deleted(unsigned int *pair_data) {
+    return   (jadwal_pair_flags(pair_data) & JADWAL_VLT_IS_DELETED); //false means occupied or empty
 }
-static bool jadwal_pair_is_occupied(struct jadwal_pair_type *prt) {
+static bool jadwal_pair_is_occupied(unsigned int *pair_data) {
     //occupied here means an active bucket that contains a value
-    JADWAL_ASSERT(!jadwal_pair_is_corrupt(prt), "corrupt element found");
-    return !jadwal_pair_is_empty(prt) && !jadwal_pair_is_deleted(prt); 
+    JADWAL_ASSERT(!jadwal_pair_is_corrupt(pair_data), "corrupt element found");
+    return !jadwal_pair_is_empty(pair_data) && !jadwal_pair_is_deleted(pair_data); 
 }
+#endif // JADWAL_GROUP_PROBE
 
 typedef void * (*jadwal_malloc_fptr)(size_t sz, void *userdata);
 typedef void * (*jadwal_realloc_fptr)(void *ptr, size_t sz, void *userdata);
 typedef void (*jadwal_free_fptr)(void *ptr, void *userdata);
+//for jadwal_try_emplace(), fills in the value of a key that was just inserted (the value starts zeroed)
+typedef void (*jadwal_value_ctor_fptr)(jadwal_key_type *key, jadwal_value_type *value, void *arg);
 
 struct jadwal_alloc_funcs {
     jadwal_malloc_fptr alloc;
     jadwal_realloc_fptr realloc;
     jadwal_free_fptr free;
 };
+#ifdef JADWAL_PARALLEL_RESIZE
+typedef void (*jadwal_task_fptr)(void *arg, long task_idx);
+//must call task(arg, i) once for every i in [0, ntasks), in any order and on any threads, and only return when all of
+//them have finished (the writes they made must be visible to the caller, joining threads takes care of that)
+typedef void (*jadwal_run_tasks_fptr)(jadwal_task_fptr task, void *arg, long ntasks, void *userdata);
+#endif
 static void *jadwal_def_malloc(size_t sz, void *unused_userdata_) {
     (void) unused_userdata_;
     return malloc(sz); 
@@ -196,8 +709,77 @@ enum JADWAL_ERR {
 };
 
 //Careful with changes!, the struct is migrated to a new one in jadwal_resize__
+#ifdef JADWAL_STATS
+//every jadwal_find(), jadwal_insert() and jadwal_remove() looks up the key once, the probe length of a lookup is
+//the number of buckets it looked at (groups with JADWAL_GROUP_PROBE), rehashing during a resize isn't counted
+struct jadwal_stats {
+    long nlookups;
+    long nprobes; //sum of the probe lengths
+    long max_probe_len;
+};
+#endif
+
+#ifdef JADWAL_HOPSCOTCH
+//bit i of hop[idx] is set when bucket idx + i (wrapping around) holds a key that hashes to idx
+#if JADWAL_HOP_RANGE == 64
+typedef uint64_t jadwal_hop_mask;
+#else
+typedef uint32_t jadwal_hop_mask;
+#endif
+static long jadwal_hop_first(jadwal_hop_mask mask) {
+#ifdef __GNUC__
+    return JADWAL_HOP_RANGE == 64 ? __builtin_ctzll(mask) : __builtin_ctz(mask);
+#else
+    long i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+#endif
+
+#ifdef JADWAL_ARENA
+//the header of a chunk, and of a block bigger than JADWAL_ARENA_MAX_SMALL (those are allocated one by one)
+struct jadwal_arena_block {
+    struct jadwal_arena_block *next;
+    struct jadwal_arena_block *prev; //only kept for big blocks, they're unlinked when freed
+};
+//memory owned by the table (see jadwal_arena_alloc()), allocated with its memfuncs and freed by jadwal_deinit()
+//small blocks are bumped out of JADWAL_ARENA_CHUNK sized chunks, a freed one is put on the free list of its size class
+//(sizes are rounded up to JADWAL_ARENA_ALIGN) and handed out again by the next allocation of that class
+struct jadwal_arena {
+    char *cur; //the unused end of the newest chunk is [cur, end)
+    char *end;
+    struct jadwal_arena_block *chunks;
+    struct jadwal_arena_block *big;
+    void *free_list[JADWAL_ARENA_NCLASSES]; //linked through the first bytes of the freed blocks
+    size_t nbytes; //handed out and not freed yet (rounded sizes)
+};
+#endif
+
 struct jadwal {
+#ifdef JADWAL_SOA
+    //structure of arrays, all of them live in one allocation that starts at keys
+    //probing only touches pair_data (or ctrl) and keys, values are only read on a hit
+    jadwal_key_type   *keys;
+    jadwal_value_type *values;
+#ifdef JADWAL_STORE_HASH
+    size_t *hashes;
+#endif
+#ifndef JADWAL_GROUP_PROBE
+    unsigned int *pair_data;
+#endif
+#else
     struct jadwal_pair_type *tab;
+#endif
+#ifdef JADWAL_GROUP_PROBE
+    unsigned char *ctrl; //nbuckets + JADWAL_GROUP_WIDTH control bytes, allocated after the buckets
+#endif
+#ifdef JADWAL_HOPSCOTCH
+    jadwal_hop_mask *hop; //one per bucket, allocated after the buckets
+#endif
 
     long nelements; //number of active buckets (ones that are not empty, and not deleted)
     long ndeleted;
@@ -207,10 +789,112 @@ struct jadwal {
     long shrink_at_lt_n; 
     long grow_at_percentage; // (divide by 100, for example 0.50 is 50)
     long shrink_at_percentage; 
+    long purge_at_gt_n; //ndeleted above this rehashes in place
+    long purge_at_percentage;
     struct jadwal_alloc_funcs memfuncs;
     void *userdata;
+#ifdef JADWAL_ARENA
+    struct jadwal_arena arena;
+#endif
+#ifdef JADWAL_STATS
+    struct jadwal_stats stats;
+#endif
+#ifdef JADWAL_PARALLEL_RESIZE
+    jadwal_run_tasks_fptr run_tasks; //NULL resizes on the calling thread
+    long ntasks;
+#endif
+#ifdef JADWAL_INCREMENTAL
+    //while growing, the table being moved out of (allocated with memfuncs), NULL otherwise
+    //its buckets before migrate_idx have been moved, moved or removed elements leave tombstones behind
+    struct jadwal *old;
+    long migrate_idx;
+#endif
 };
 
+//bucket accessors, these hide whether buckets are stored as an array of structs or as a structure of arrays
+static jadwal_key_type *jadwal_key_at(struct jadwal *ht, long idx) {
+#ifdef JADWAL_SOA
+    return ht->keys + idx;
+#else
+    return &ht->tab[idx].key;
+#endif
+}
+static jadwal_value_type *jadwal_value_at(struct jadwal *ht, long idx) {
+#ifdef JADWAL_SOA
+    return ht->values + idx;
+#else
+    return &ht->tab[idx].value;
+#endif
+}
+#ifdef JADWAL_STORE_HASH
+static size_t *jadwal_hash_at(struct jadwal *ht, long idx) {
+#ifdef JADWAL_SOA
+    return ht->hashes + idx;
+#else
+    return &ht->tab[idx].hash;
+#endif
+}
+#endif
+#ifndef JADWAL_GROUP_PROBE
+static unsigned int *jadwal_pair_data_at(struct jadwal *ht, long idx) {
+#ifdef JADWAL_SOA
+    return ht->pair_data + idx;
+#else
+    return &ht->tab[idx].pair_data;
+#endif
+}
+#endif
+//start of the allocation that holds the buckets
+static void *jadwal_tab_mem(struct jadwal *ht) {
+#ifdef JADWAL_SOA
+    return ht->keys;
+#else
+    return ht->tab;
+#endif
+}
+
+//bucket state by index, unlike the jadwal_pair_* functions these also work when the state is kept in control bytes
+static bool jadwal_slot_is_empty(struct jadwal *ht, long idx) {
+#ifdef JADWAL_GROUP_PROBE
+    return ht->ctrl[idx] == JADWAL_CTRL_EMPTY;
+#else
+    return jadwal_pair_is_empty(jadwal_pair_data_at(ht, idx));
+#endif
+}
+static bool jadwal_slot_is_deleted(struct jadwal *ht, long idx) {
+#ifdef JADWAL_GROUP_PROBE
+    return ht->ctrl[idx] == JADWAL_CTRL_DELETED;
+#else
+    return jadwal_pair_is_deleted(jadwal_pair_data_at(ht, idx));
+#endif
+}
+static bool jadwal_slot_is_corrupt(struct jadwal *ht, long idx) {
+#ifdef JADWAL_GROUP_PROBE
+    unsigned char ctrl = ht->ctrl[idx];
+    return !(ctrl & JADWAL_CTRL_OCCUPIED) && ctrl != JADWAL_CTRL_EMPTY && ctrl != JADWAL_CTRL_DELETED;
+#else
+    return jadwal_pair_is_corrupt(jadwal_pair_data_at(ht, idx));
+#endif
+}
+static bool jadwal_slot_is_occupied(struct jadwal *ht, long idx) {
+#ifdef JADWAL_GROUP_PROBE
+    JADWAL_ASSERT(!jadwal_slot_is_corrupt(ht, idx), "corrupt element found");
+    return ht->ctrl[idx] & JADWAL_CTRL_OCCUPIED;
+#else
+    return jadwal_pair_is_occupied(jadwal_pair_data_at(ht, idx));
+#endif
+}
+
+#ifdef JADWAL_GROUP_PROBE
+static void jadwal_set_ctrl(struct jadwal *ht, long idx, unsigned char ctrl) {
+    ht->ctrl[idx] = ctrl;
+    //the first JADWAL_GROUP_WIDTH control bytes are mirrored past the end, so that loading a group never has to wrap around
+    //(the loop runs more than once only when the table is smaller than a group)
+    for (long i = idx + ht->nbuckets; i < ht->nbuckets + JADWAL_GROUP_WIDTH; i += ht->nbuckets)
+        ht->ctrl[i] = ctrl;
+}
+#endif
+
 
 //shrink at, grow at are percentages [0, 99] inclusive, they must fulfil (grow_at / shrink_at) > 2.0
 //the function can fail
@@ -241,9 +925,32 @@ static int jadwal_set_parameters(struct jadwal *ht, long shrink_at, long grow_at
     //this can potentially overflow, maybe we should cast to size_t
     ht->grow_at_gt_n = (ht->nbuckets * ht->grow_at_percentage) / 100;
     ht->shrink_at_lt_n = (ht->nbuckets * ht->shrink_at_percentage) / 100;
+    ht->purge_at_gt_n = (ht->nbuckets * ht->purge_at_percentage) / 100;
     return rv;
 }
 
+//percentage [1, 99] of the buckets that tombstones can take before an insert rehashes the table in place
+//(only relevant for the modes that leave tombstones behind, not for JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH)
+static int jadwal_set_purge_at(struct jadwal *ht, long purge_at) {
+    if (purge_at > 99 || purge_at < 1)
+        return JADWAL_INVALID_REQ_SZ;
+    ht->purge_at_percentage = purge_at;
+    ht->purge_at_gt_n = (ht->nbuckets * ht->purge_at_percentage) / 100;
+    return JADWAL_OK;
+}
+
+#ifdef JADWAL_PARALLEL_RESIZE
+//big resizes are split into ntasks [1, JADWAL_MAX_TASKS] tasks that run_tasks runs (ht->userdata is passed to it),
+//a run_tasks of NULL resizes on the calling thread
+static int jadwal_set_task_runner(struct jadwal *ht, jadwal_run_tasks_fptr run_tasks, long ntasks) {
+    if (ntasks < 1 || ntasks > JADWAL_MAX_TASKS)
+        return JADWAL_INVALID_REQ_SZ;
+    ht->run_tasks = run_tasks;
+    ht->ntasks = ntasks;
+    return JADWAL_OK;
+}
+#endif
+
 static long jadwal_calc_nelements_to_nbuckets(long needed_nelements, long shrink_at_percentage, long grow_at_percentage) {
     //let ratio = needed_nelements / x 
     //we want an x that fullfills: 
@@ -287,12 +994,11 @@ static int jadwal_change_sz_field(struct jadwal *ht, long nbuckets, bool force)
     (void) force;
     //ignore values that are too small
     nbuckets = nbuckets < JADWAL_MIN_TABLESIZE ? JADWAL_MIN_TABLESIZE : nbuckets;
-    long nbuckets_po2 = jadwal_get_jprimes_power_idx(nbuckets);
+    long nbuckets_po2 = jadwal_get_size_class(nbuckets);
     if (nbuckets_po2 < 0)
         return JADWAL_INVALID_REQ_SZ; //too big
-    JADWAL_ASSERT(nbuckets_po2 >= 2 && nbuckets_po2 < jprimes_n_values, "jprimes failed");
-    long nbuckets_prime = jprimes_values[nbuckets_po2];
-    ht->nbuckets     = nbuckets_prime;
+    JADWAL_ASSERT(nbuckets_po2 >= 2 && nbuckets_po2 < jadwal_n_size_classes, "size class lookup failed");
+    ht->nbuckets     = jadwal_size_class_nbuckets(nbuckets_po2);
     ht->nbuckets_po2 = nbuckets_po2;
     
     JADWAL_ASSERT(ht->shrink_at_percentage > 0 && ht->grow_at_percentage > ht->shrink_at_percentage, "invalid growth parameters");
@@ -308,16 +1014,16 @@ static int jadwal_change_sz_field(struct jadwal *ht, long nbuckets, bool force)
 static bool jadwal_dbg_check(struct jadwal *ht, long beg_idx, long end_idx, int query_empty, int query_deleted, int query_corrupt) {
     long len = end_idx - beg_idx;
     for (int i=0; i<len; i++) {
-        struct jadwal_pair_type *pair = ht->tab + i + beg_idx;
+        long idx = i + beg_idx;
         int expect[3] = {
             query_empty,
             query_deleted,
             query_corrupt, 
         };
         int found[3] = { 
-            jadwal_pair_is_empty(pair),
-            jadwal_pair_is_deleted(pair),
-            jadwal_pair_is_corrupt(pair),
+            jadwal_slot_is_empty(ht, idx),
+            jadwal_slot_is_deleted(ht, idx),
+            jadwal_slot_is_corrupt(ht, idx),
         };
         for (int i=0; i<3; i++) {
             if (((expect[i] > 0) && !found[i]) || ((expect[i] < 0) && found[i]))
@@ -328,9 +1034,9 @@ static bool jadwal_dbg_check(struct jadwal *ht, long beg_idx, long end_idx, int
 }
 
 static bool jadwal_dbg_sanity_01(struct jadwal *ht) {
-    return ht->tab &&
+    return jadwal_tab_mem(ht) &&
            ht->nbuckets &&
-           (ht->nbuckets_po2 == jadwal_get_jprimes_power_idx(ht->nbuckets)) &&
+           (ht->nbuckets_po2 == jadwal_get_size_class(ht->nbuckets)) &&
            (ht->shrink_at_lt_n < ht->grow_at_gt_n);
 }
 static bool jadwal_dbg_sanity_heavy(struct jadwal *ht) {
@@ -340,10 +1046,200 @@ static bool jadwal_dbg_sanity_heavy(struct jadwal *ht) {
 static void jadwal_memset(struct jadwal *ht, long begin_inc, long end_exc) {
     JADWAL_ASSERT(jadwal_dbg_sanity_01(ht), "jadwal corrupt or not initialized");
     //the flags are designed so that memsetting with 0 means: empty, not deleted, not corrupt
+#ifdef JADWAL_GROUP_PROBE
+    memset(ht->ctrl + begin_inc, 0, end_exc - begin_inc);
+    for (long i=0; i<JADWAL_GROUP_WIDTH; i++)
+        ht->ctrl[ht->nbuckets + i] = ht->ctrl[i % ht->nbuckets];
+#elif defined(JADWAL_SOA)
+    memset(ht->pair_data + begin_inc, 0, sizeof(unsigned int) * (end_exc - begin_inc));
+#endif
+#ifndef JADWAL_SOA
     memset(ht->tab + begin_inc, 0, sizeof(struct jadwal_pair_type) * (end_exc - begin_inc));
+#endif
+#ifdef JADWAL_HOPSCOTCH
+    memset(ht->hop + begin_inc, 0, sizeof(jadwal_hop_mask) * (end_exc - begin_inc));
+#endif
     JADWAL_ASSERT(jadwal_dbg_check(ht, begin_inc, end_exc, 1, -1, -1), "");
 }
 
+#ifdef JADWAL_SOA
+//every array starts on its own cache line
+#define JADWAL_SOA_ALIGN 64
+static size_t jadwal_soa_round_up(size_t sz) {
+    return (sz + JADWAL_SOA_ALIGN - 1) & ~((size_t) JADWAL_SOA_ALIGN - 1);
+}
+#endif
+
+#ifdef JADWAL_HOPSCOTCH
+//the bitmaps come after the buckets, aligned for their type
+static size_t jadwal_hop_round_up(size_t sz) {
+    return (sz + sizeof(jadwal_hop_mask) - 1) & ~(sizeof(jadwal_hop_mask) - 1);
+}
+#endif
+
+//size of the single allocation that holds the buckets (and the control bytes if any)
+static size_t jadwal_tab_alloc_size(long nbuckets) {
+#ifdef JADWAL_SOA
+    size_t sz = jadwal_soa_round_up(sizeof(jadwal_key_type) * nbuckets) + jadwal_soa_round_up(sizeof(jadwal_value_type) * nbuckets);
+  #ifdef JADWAL_STORE_HASH
+    sz += jadwal_soa_round_up(sizeof(size_t) * nbuckets);
+  #endif
+  #ifndef JADWAL_GROUP_PROBE
+    sz += sizeof(unsigned int) * nbuckets;
+  #endif
+#else
+    size_t sz = sizeof(struct jadwal_pair_type) * nbuckets;
+#endif
+#ifdef JADWAL_GROUP_PROBE
+    sz += nbuckets + JADWAL_GROUP_WIDTH;
+#endif
+#ifdef JADWAL_HOPSCOTCH
+    sz = jadwal_hop_round_up(sz) + sizeof(jadwal_hop_mask) * nbuckets;
+#endif
+    return sz;
+}
+//points the bucket arrays into mem, which is jadwal_tab_alloc_size(ht->nbuckets) bytes (or NULL)
+static void jadwal_set_tab_mem(struct jadwal *ht, void *mem) {
+    char *cur = mem;
+#ifdef JADWAL_SOA
+    ht->keys = mem;
+    cur += jadwal_soa_round_up(sizeof(jadwal_key_type) * ht->nbuckets);
+    ht->values = (jadwal_value_type *) cur;
+    cur += jadwal_soa_round_up(sizeof(jadwal_value_type) * ht->nbuckets);
+  #ifdef JADWAL_STORE_HASH
+    ht->hashes = (size_t *) cur;
+    cur += jadwal_soa_round_up(sizeof(size_t) * ht->nbuckets);
+  #endif
+  #ifndef JADWAL_GROUP_PROBE
+    ht->pair_data = (unsigned int *) cur;
+    cur += sizeof(unsigned int) * ht->nbuckets;
+  #endif
+#else
+    ht->tab = mem;
+    cur += sizeof(struct jadwal_pair_type) * ht->nbuckets;
+#endif
+#ifdef JADWAL_GROUP_PROBE
+    ht->ctrl = (unsigned char *) cur;
+#endif
+#ifdef JADWAL_HOPSCOTCH
+    ht->hop = mem ? (jadwal_hop_mask *) ((char *) mem + jadwal_hop_round_up(cur - (char *) mem)) : NULL;
+#endif
+    (void) cur;
+}
+
+#ifdef JADWAL_ARENA
+static size_t jadwal_arena_round_up__(size_t sz) {
+    if (sz == 0)
+        return JADWAL_ARENA_ALIGN;
+    return (sz + JADWAL_ARENA_ALIGN - 1) & ~(size_t) (JADWAL_ARENA_ALIGN - 1);
+}
+static size_t jadwal_arena_hdr_size__(void) {
+    return jadwal_arena_round_up__(sizeof(struct jadwal_arena_block));
+}
+static void jadwal_arena_init__(struct jadwal_arena *arena) {
+    memset(arena, 0, sizeof *arena);
+}
+static void jadwal_arena_push_free__(struct jadwal_arena *arena, void *mem, size_t rounded) {
+    void **head = &arena->free_list[rounded / JADWAL_ARENA_ALIGN - 1];
+    memcpy(mem, head, sizeof *head);
+    *head = mem;
+}
+static void jadwal_arena_free_list__(struct jadwal *ht, struct jadwal_arena_block *block) {
+    while (block) {
+        struct jadwal_arena_block *next = block->next;
+        ht->memfuncs.free(block, ht->userdata);
+        block = next;
+    }
+}
+//frees all of it at once, the blocks handed out are invalid after this
+static void jadwal_arena_release__(struct jadwal *ht) {
+    jadwal_arena_free_list__(ht, ht->arena.chunks);
+    jadwal_arena_free_list__(ht, ht->arena.big);
+    jadwal_arena_init__(&ht->arena);
+}
+//resizing builds a new struct jadwal, the arena (which the keys can point into) goes over to it, src is left empty
+static void jadwal_arena_move__(struct jadwal *dst, struct jadwal *src) {
+    JADWAL_ASSERT(!dst->arena.chunks && !dst->arena.big, "the destination arena must be empty");
+    dst->arena = src->arena;
+    jadwal_arena_init__(&src->arena);
+}
+static int jadwal_arena_new_chunk__(struct jadwal *ht) {
+    struct jadwal_arena *arena = &ht->arena;
+    struct jadwal_arena_block *chunk = ht->memfuncs.alloc(JADWAL_ARENA_CHUNK, ht->userdata);
+    if (!chunk)
+        return JADWAL_ALLOC_ERR;
+    //what is left of the current chunk is smaller than the block that didn't fit, so it has a size class
+    if (arena->cur && arena->cur != arena->end)
+        jadwal_arena_push_free__(arena, arena->cur, arena->end - arena->cur);
+    chunk->next = arena->chunks;
+    chunk->prev = NULL;
+    arena->chunks = chunk;
+    arena->cur = (char *) chunk + jadwal_arena_hdr_size__();
+    arena->end = (char *) chunk + JADWAL_ARENA_CHUNK;
+    return JADWAL_OK;
+}
+
+//sz bytes (aligned to JADWAL_ARENA_ALIGN) that belong to the table, they're valid until they're given back with
+//jadwal_arena_free() or the table is deinitialized, returns NULL when the memory can't be allocated
+static void *jadwal_arena_alloc(struct jadwal *ht, size_t sz) {
+    struct jadwal_arena *arena = &ht->arena;
+    size_t hdr = jadwal_arena_hdr_size__();
+    if (sz > ((size_t) -1) / 2)
+        return NULL;
+    size_t rounded = jadwal_arena_round_up__(sz);
+    if (rounded > JADWAL_ARENA_MAX_SMALL) {
+        struct jadwal_arena_block *block = ht->memfuncs.alloc(hdr + rounded, ht->userdata);
+        if (!block)
+            return NULL;
+        block->next = arena->big;
+        block->prev = NULL;
+        if (arena->big)
+            arena->big->prev = block;
+        arena->big = block;
+        arena->nbytes += rounded;
+        return (char *) block + hdr;
+    }
+    void **head = &arena->free_list[rounded / JADWAL_ARENA_ALIGN - 1];
+    void *mem = *head;
+    if (mem) {
+        memcpy(head, mem, sizeof *head);
+    }
+    else {
+        if (!arena->cur || (size_t) (arena->end - arena->cur) < rounded) {
+            if (jadwal_arena_new_chunk__(ht) != JADWAL_OK)
+                return NULL;
+        }
+        mem = arena->cur;
+        arena->cur += rounded;
+    }
+    arena->nbytes += rounded;
+    return mem;
+}
+
+//gives back memory from jadwal_arena_alloc() of the same table, sz must be the size that was asked for, ptr can be NULL
+static void jadwal_arena_free(struct jadwal *ht, void *ptr, size_t sz) {
+    struct jadwal_arena *arena = &ht->arena;
+    if (!ptr)
+        return;
+    size_t rounded = jadwal_arena_round_up__(sz);
+    JADWAL_ASSERT(arena->nbytes >= rounded, "freeing more than was allocated");
+    arena->nbytes -= rounded;
+    if (rounded > JADWAL_ARENA_MAX_SMALL) {
+        struct jadwal_arena_block *block = (struct jadwal_arena_block *) ((char *) ptr - jadwal_arena_hdr_size__());
+        if (block->prev)
+            block->prev->next = block->next;
+        else
+            arena->big = block->next;
+        if (block->next)
+            block->next->prev = block->prev;
+        ht->memfuncs.free(block, ht->userdata);
+        return;
+    }
+    JADWAL_DBG_CODE(memset(ptr, 0x3c, rounded););
+    jadwal_arena_push_free__(arena, ptr, rounded);
+}
+#endif // JADWAL_ARENA
+
 static int jadwal_init_ex(struct jadwal *ht,
                         long initial_nelements, 
                         jadwal_malloc_fptr alloc,
@@ -363,6 +1259,21 @@ static int jadwal_init_ex(struct jadwal *ht,
     ht->ndeleted = 0;
     ht->nbuckets_po2 = 0;
     ht->userdata = userdata;
+    ht->purge_at_percentage = JADWAL_DEFAULT_PURGE_AT;
+#ifdef JADWAL_ARENA
+    jadwal_arena_init__(&ht->arena);
+#endif
+#ifdef JADWAL_INCREMENTAL
+    ht->old = NULL;
+    ht->migrate_idx = 0;
+#endif
+#ifdef JADWAL_PARALLEL_RESIZE
+    ht->run_tasks = NULL;
+    ht->ntasks = 1;
+#endif
+#ifdef JADWAL_STATS
+    memset(&ht->stats, 0, sizeof ht->stats);
+#endif
 
     rv = jadwal_init_parameters(ht, shrink_at_percentage, grow_at_percentage);
     if (rv != JADWAL_OK)
@@ -373,10 +1284,17 @@ static int jadwal_init_ex(struct jadwal *ht,
     if (rv != JADWAL_OK)
         return rv;
 
-    ht->tab = ht->memfuncs.alloc(sizeof(struct jadwal_pair_type) * ht->nbuckets, ht->userdata);
-    if (!ht->tab)
+    //with the default allocator ask for zeroed memory instead of clearing it here, big tables then come as fresh pages
+    //that are only touched when used, growing a big table doesn't have to write all of it up front
+    bool zeroed = (alloc == jadwal_def_malloc);
+    void *mem = zeroed ? calloc(1, jadwal_tab_alloc_size(ht->nbuckets)) :
+                         ht->memfuncs.alloc(jadwal_tab_alloc_size(ht->nbuckets), ht->userdata);
+    if (!mem)
         return JADWAL_ALLOC_ERR;
-    jadwal_memset(ht, 0, ht->nbuckets); //mark everything empty
+    jadwal_set_tab_mem(ht, mem);
+    if (!zeroed)
+        jadwal_memset(ht, 0, ht->nbuckets); //mark everything empty
+    JADWAL_ASSERT(jadwal_dbg_check(ht, 0, ht->nbuckets, 1, -1, -1), "");
     return JADWAL_OK;
 }
 
@@ -394,6 +1312,14 @@ static int jadwal_init_copy_settings(struct jadwal *ht,
                         source->shrink_at_percentage, //long shrink_at_percentage,
                         source->grow_at_percentage //long grow_at_percentage)
                         );
+    if (rv == JADWAL_OK)
+        jadwal_set_purge_at(ht, source->purge_at_percentage);
+#ifdef JADWAL_PARALLEL_RESIZE
+    if (rv == JADWAL_OK) {
+        ht->run_tasks = source->run_tasks;
+        ht->ntasks = source->ntasks;
+    }
+#endif
     return rv;
 }
 
@@ -404,8 +1330,8 @@ static int jadwal_init_with_udata(struct jadwal *ht, long initial_nelements, voi
                         jadwal_def_realloc,//jadwal_realloc_fptr realloc,
                         jadwal_def_free,// jadwal_free_fptr free,
                         userdata, //void *userdata,
-                        20, //long shrink_at_percentage,
-                        60 //long grow_at_percentage)
+                        JADWAL_DEFAULT_SHRINK_AT, //long shrink_at_percentage,
+                        JADWAL_DEFAULT_GROW_AT //long grow_at_percentage)
                         );
 }
 
@@ -414,13 +1340,26 @@ static int jadwal_init(struct jadwal *ht, long initial_nelements) {
 }
 
 static void jadwal_deinit(struct jadwal *ht) {
-    ht->memfuncs.free(ht->tab, ht->userdata);
-    ht->tab = NULL;
+#ifdef JADWAL_INCREMENTAL
+    if (ht->old) {
+        jadwal_deinit(ht->old);
+        ht->memfuncs.free(ht->old, ht->userdata);
+        ht->old = NULL;
+    }
+#endif
+    ht->memfuncs.free(jadwal_tab_mem(ht), ht->userdata);
     ht->nbuckets = 0;
     ht->nbuckets_po2 = 0;
+    jadwal_set_tab_mem(ht, NULL);
+#ifdef JADWAL_ARENA
+    jadwal_arena_release__(ht);
+#endif
 }
+#ifdef JADWAL_POW2
+//fibonacci hashing, multiply by 2^64 / golden ratio and keep the top nbuckets_po2 bits
+//the low bits of the hash (which weak hashes like the identity leave poorly mixed) affect all of the top bits
 static long jadwal_integer_mod_buckets(struct jadwal *ht, size_t full_hash) {
-    long divd_hash = full_hash % jprimes_values[ht->nbuckets_po2];
+    long divd_hash = (long) (((uint64_t) full_hash * 0x9E3779B97F4A7C15ULL) >> (64 - ht->nbuckets_po2));
     JADWAL_ASSERT(divd_hash < ht->nbuckets, "");
     return divd_hash;
 }
@@ -428,14 +1367,104 @@ static long jadwal_integer_mod_buckets(struct jadwal *ht, size_t full_hash) {
 //precondition: idx can only be in [-1...nbuckets] (inclusive both ends)
 static long jadwal_idx_mod_buckets(struct jadwal *ht, long idx) {
     JADWAL_ASSERT(idx >= -1 && idx <= ht->nbuckets, "");
-    if (idx < 0)
-        return ht->nbuckets - 1;
-    if (idx >= ht->nbuckets)
-        return 0;
-    return idx;
+    return idx & (ht->nbuckets - 1);
 }
-
-static long jadwal_n_unused_buckets(struct jadwal *ht) {
+#else
+static long jadwal_integer_mod_buckets(struct jadwal *ht, size_t full_hash) {
+#if defined(__SIZEOF_INT128__) && !defined(JADWAL_NO_FASTMOD)
+    //multiply by a precomputed reciprocal of the prime instead of dividing by it, the result is exact
+    JADWAL_ASSERT(adiv_values[ht->nbuckets_po2] == jprimes_values[ht->nbuckets_po2], "div_32_funcs.h doesn't match jprimes_values");
+    long divd_hash = (long) adiv_fastmod((uint64_t) full_hash, (int) ht->nbuckets_po2);
+#else
+    long divd_hash = full_hash % jprimes_values[ht->nbuckets_po2];
+#endif
+    JADWAL_ASSERT(divd_hash < ht->nbuckets, "");
+    return divd_hash;
+}
+
+//precondition: idx can only be in [-1...nbuckets] (inclusive both ends)
+static long jadwal_idx_mod_buckets(struct jadwal *ht, long idx) {
+    JADWAL_ASSERT(idx >= -1 && idx <= ht->nbuckets, "");
+    if (idx < 0)
+        return ht->nbuckets - 1;
+    if (idx >= ht->nbuckets)
+        return 0;
+    return idx;
+}
+#endif
+
+#ifdef JADWAL_GROUP_PROBE
+//precondition: idx can only be in [0...nbuckets + JADWAL_GROUP_WIDTH) 
+static long jadwal_group_idx_mod_buckets(struct jadwal *ht, long idx) {
+    JADWAL_ASSERT(idx >= 0 && idx < ht->nbuckets + JADWAL_GROUP_WIDTH, "");
+#ifdef JADWAL_POW2
+    return idx & (ht->nbuckets - 1);
+#else
+    while (idx >= ht->nbuckets)
+        idx -= ht->nbuckets;
+    return idx;
+#endif
+}
+#endif
+
+#ifdef JADWAL_HOPSCOTCH
+//precondition: idx can only be in (-nbuckets...2 * nbuckets)
+static long jadwal_hop_wrap__(struct jadwal *ht, long idx) {
+    JADWAL_ASSERT(idx > -ht->nbuckets && idx < 2 * ht->nbuckets, "");
+    if (idx < 0)
+        return idx + ht->nbuckets;
+    if (idx >= ht->nbuckets)
+        return idx - ht->nbuckets;
+    return idx;
+}
+#endif
+
+//probe sequences, step is what jadwal_probe_step() returned for the key, i is the number of buckets probed before idx
+//every sequence visits all buckets before coming back to the first one, so a probe always reaches an empty bucket
+static long jadwal_probe_step(struct jadwal *ht, size_t full_hash) {
+#ifdef JADWAL_PROBE_DOUBLE_HASH
+    //remixed first so that weak hashes (like the identity of a small integer) don't all get the same step
+    uint64_t upper = ((uint64_t) full_hash * 0xC2B2AE3D27D4EB4FULL) >> 32;
+#ifdef JADWAL_POW2
+    return (long) ((upper | 1) & (uint64_t) (ht->nbuckets - 1)); //odd steps are coprime with a power of two
+#else
+    return 1 + (long) (upper % (uint64_t) (ht->nbuckets - 1)); //any step below a prime is coprime with it
+#endif
+#else
+    (void) ht;
+    (void) full_hash;
+    return 1;
+#endif
+}
+
+static long jadwal_probe_next(struct jadwal *ht, long idx, long i, long step) {
+#if defined(JADWAL_PROBE_TRIANGULAR)
+    (void) step;
+    return (idx + i + 1) & (ht->nbuckets - 1);
+#elif defined(JADWAL_PROBE_DOUBLE_HASH)
+    (void) i;
+    idx += step;
+    return idx >= ht->nbuckets ? idx - ht->nbuckets : idx;
+#else
+    (void) i;
+    (void) step;
+    return jadwal_idx_mod_buckets(ht, idx + 1);
+#endif
+}
+
+static void jadwal_stats_record__(struct jadwal *ht, long probe_len) {
+#ifdef JADWAL_STATS
+    ht->stats.nlookups++;
+    ht->stats.nprobes += probe_len;
+    if (probe_len > ht->stats.max_probe_len)
+        ht->stats.max_probe_len = probe_len;
+#else
+    (void) ht;
+    (void) probe_len;
+#endif
+}
+
+static long jadwal_n_unused_buckets(struct jadwal *ht) {
     return ht->nbuckets - ht->nelements;
 }
 static long jadwal_n_empty_buckets(struct jadwal *ht) {
@@ -449,64 +1478,147 @@ static long jadwal_n_used_buckets(struct jadwal *ht) {
     return ht->nelements;
 }
 
-//returns 0 if equal
-static int jadwal_cmp(struct jadwal *ht, jadwal_key_type *key1, unsigned int partial_hash_1, struct jadwal_pair_type *pair) {
+//returns 0 if equal, key2 is the one stored in the table
+static int jadwal_key_cmp__(struct jadwal *ht, jadwal_key_type *key1, jadwal_key_type *key2) {
     (void) ht;
+#ifdef JADWAL_DATA_ARG
+    JADWAL_ASSERT(jadwal_key_eq_cmp(ht->userdata, key2, key2) == 0, "jadwal_key_eq_cmp() is broken,"
+                                                            " testing it on the same key fails to report it's equal to itself");
+    return jadwal_key_eq_cmp(ht->userdata, key1, key2);
+#else
+    JADWAL_ASSERT(jadwal_key_eq_cmp(key2, key2) == 0, "jadwal_key_eq_cmp() is broken,"
+                                                            " testing it on the same key fails to report it's equal to itself");
+    return jadwal_key_eq_cmp(           key1, key2);
+#endif
+}
 
+#ifndef JADWAL_GROUP_PROBE
+//returns 0 if equal
+static int jadwal_cmp(struct jadwal *ht, jadwal_key_type *key1, unsigned int partial_hash_1, long idx) {
     //skip full key comparison
-    if (jadwal_pair_get_partial_hash(pair) != partial_hash_1)
+    if (jadwal_pair_get_partial_hash(jadwal_pair_data_at(ht, idx)) != partial_hash_1)
         return 1; 
 
+    return jadwal_key_cmp__(ht, key1, jadwal_key_at(ht, idx));
+}
+#endif
 
+static size_t jadwal_key_hash__(struct jadwal *ht, jadwal_key_type *key) {
 #ifdef JADWAL_DATA_ARG
-    JADWAL_ASSERT(jadwal_key_eq_cmp(ht->userdata, &pair->key, &pair->key) == 0, "jadwal_key_eq_cmp() is broken,"
-                                                            " testing it on the same key fails to report it's equal to itself");
-    return jadwal_key_eq_cmp(ht->userdata, key1, &pair->key);
+    return jadwal_hash(ht->userdata, key);
 #else
-    JADWAL_ASSERT(jadwal_key_eq_cmp(&pair->key, &pair->key) == 0, "jadwal_key_eq_cmp() is broken,"
-                                                            " testing it on the same key fails to report it's equal to itself");
-    return jadwal_key_eq_cmp(           key1, &pair->key);
+    (void) ht;
+    return jadwal_hash(key);
 #endif
 }
 
 //on successful match, returns JADWAL_OK
 //otherwise unless an error occurs it returns NOT_FOUND and out_idx will hold a suggested place to insert 
 //if we have no suggested place then out_idx is set to NOT_FOUND too
-static inline int jadwal_find_pos__(struct jadwal *ht, jadwal_key_type *key, long *out_idx, size_t *full_hash_out) {
-    JADWAL_ASSERT(out_idx && full_hash_out, "");
+//full_hash must be what jadwal_hash() returns for key
+static inline int jadwal_find_pos_hashed__(struct jadwal *ht, jadwal_key_type *key, size_t full_hash, long *out_idx) {
+    JADWAL_ASSERT(out_idx, "");
 
-    #ifdef JADWAL_DATA_ARG
-        size_t full_hash = jadwal_hash(ht->userdata, key);
-    #else
-        size_t full_hash = jadwal_hash(key);
-    #endif
-    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
-    *full_hash_out = full_hash;
     long idx = jadwal_integer_mod_buckets(ht, full_hash);
     long suggested = JADWAL_NOT_FOUND; //suggest where to insert
 
     if (jadwal_n_empty_buckets(ht) < 1) {
         //note that if jadwal_n_unused_buckets is anywhere near one it'll be a very a slow search anyways
         JADWAL_ASSERT(false, "precondition violated, this leads to an infinite loop");
+        *out_idx = JADWAL_NOT_FOUND;
         return JADWAL_INVALID_TABLE_STATE;
     }
 
+#ifdef JADWAL_GROUP_PROBE
+    //same linear probing as below, but JADWAL_GROUP_WIDTH buckets are looked at per step
+    unsigned char tag = jadwal_hash_to_ctrl_tag(full_hash);
+    for (long ngroups = 1; ; ngroups++) {
+        const unsigned char *group = ht->ctrl + idx;
+        jadwal_group_mask empty = jadwal_group_match(group, JADWAL_CTRL_EMPTY);
+        jadwal_group_mask match = jadwal_group_match(group, tag);
+        if (empty)
+            match &= (empty & (~empty + 1)) - 1; //the key can't be past the first empty bucket
+        for (; match; match &= match - 1) {
+            long match_idx = jadwal_group_idx_mod_buckets(ht, idx + jadwal_group_mask_first(match));
+            if (jadwal_key_cmp__(ht, key, jadwal_key_at(ht, match_idx)) == 0) {
+                jadwal_stats_record__(ht, ngroups);
+                *out_idx = match_idx;
+                return JADWAL_OK; //found
+            }
+        }
+        if (suggested == JADWAL_NOT_FOUND) {
+            jadwal_group_mask free_mask = jadwal_group_match_free(group);
+            if (free_mask)
+                suggested = jadwal_group_idx_mod_buckets(ht, idx + jadwal_group_mask_first(free_mask));
+        }
+        if (empty) {
+            jadwal_stats_record__(ht, ngroups);
+            *out_idx = suggested;
+            return JADWAL_NOT_FOUND;
+        }
+        idx = jadwal_group_idx_mod_buckets(ht, idx + JADWAL_GROUP_WIDTH);
+    }
+#else
+    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
+#if defined(JADWAL_HOPSCOTCH)
+    //only the buckets in the home bucket's bitmap can hold the key, so a miss costs the same as a hit
+    //on a miss out_idx is the home bucket, jadwal_insert__ makes room in its neighbourhood (jadwal_hop_make_room__)
+    long home = idx;
+    long nprobes = 1;
+    for (jadwal_hop_mask hop = ht->hop[home]; hop; hop &= hop - 1) {
+        idx = jadwal_hop_wrap__(ht, home + jadwal_hop_first(hop));
+        nprobes++;
+        if (jadwal_cmp(ht, key, partial_hash, idx) == 0) {
+            jadwal_stats_record__(ht, nprobes);
+            *out_idx = idx;
+            return JADWAL_OK; //found
+        }
+    }
+    jadwal_stats_record__(ht, nprobes);
+    *out_idx = home;
+    (void) suggested;
+    return JADWAL_NOT_FOUND;
+#elif defined(JADWAL_ROBIN_HOOD)
+    //buckets in a run are ordered by probe distance, so a miss can stop at the first bucket that is closer to its home than
+    //the key would be, that bucket is also where the key belongs (the run after it gets shifted forward on insertion)
+    //the loop is bounded since no stored distance is above JADWAL_RH_MAX_DIST
+    for (long dist = 0; ; dist++) {
+        unsigned int *pair_data = jadwal_pair_data_at(ht, idx);
+        if (jadwal_pair_is_empty(pair_data) || jadwal_pair_get_dist(pair_data) < dist) {
+            jadwal_stats_record__(ht, dist + 1);
+            *out_idx = idx;
+            return JADWAL_NOT_FOUND;
+        }
+        if (jadwal_cmp(ht, key, partial_hash, idx) == 0) {
+            jadwal_stats_record__(ht, dist + 1);
+            *out_idx = idx;
+            return JADWAL_OK; //found
+        }
+        idx = jadwal_idx_mod_buckets(ht, idx + 1);
+    }
+    (void) suggested;
+#else
+    long step = jadwal_probe_step(ht, full_hash);
     //we can probably use an upper iteration count, in case there is memory corruption, but we just ignore that here, we assume the user is sane
-    while (1) {
-        struct jadwal_pair_type *pair = ht->tab + idx;
-        if (jadwal_pair_is_occupied(pair)) {
-            if (jadwal_cmp(ht, key, partial_hash, pair) == 0) {
+    for (long i = 0; ; i++) {
+        //one read of the bucket state, with jadwal_concurrent.h a writer can change it while this looks
+        unsigned int pair_data_copy = *jadwal_pair_data_at(ht, idx);
+        unsigned int *pair_data = &pair_data_copy;
+        if (jadwal_pair_is_occupied(pair_data)) {
+            if (jadwal_cmp(ht, key, partial_hash, idx) == 0) {
+                jadwal_stats_record__(ht, i + 1);
                 *out_idx = idx;
                 return JADWAL_OK; //found
             }
         }
-        else if (jadwal_pair_is_deleted(pair)) {
+        else if (jadwal_pair_is_deleted(pair_data)) {
             if (suggested == JADWAL_NOT_FOUND)
                 suggested = idx; 
         }
-        else if (jadwal_pair_is_empty(pair)) {
+        else if (jadwal_pair_is_empty(pair_data)) {
             if (suggested == JADWAL_NOT_FOUND)
                 suggested = idx;
+            jadwal_stats_record__(ht, i + 1);
             *out_idx = suggested;
             return JADWAL_NOT_FOUND;
         }
@@ -515,17 +1627,104 @@ static inline int jadwal_find_pos__(struct jadwal *ht, jadwal_key_type *key, lon
             JADWAL_ASSERT(false, "invalid bucket state");
         }
 #endif
-        idx = jadwal_idx_mod_buckets(ht, idx + 1); //this is where we can change linear probing
+        idx = jadwal_probe_next(ht, idx, i, step);
     }
+#endif // JADWAL_ROBIN_HOOD
+#endif // JADWAL_GROUP_PROBE
 
     //unreachable
     *out_idx = JADWAL_NOT_FOUND;
     return JADWAL_INVALID_TABLE_STATE;
 }
+//same as jadwal_find_pos_hashed__(), hashes the key and returns the hash in full_hash_out
+static inline int jadwal_find_pos__(struct jadwal *ht, jadwal_key_type *key, long *out_idx, size_t *full_hash_out) {
+    JADWAL_ASSERT(full_hash_out, "");
+    *full_hash_out = jadwal_key_hash__(ht, key);
+    return jadwal_find_pos_hashed__(ht, key, *full_hash_out, out_idx);
+}
+
+//what the occupied bucket idx keeps of the hash of its element: the full hash with JADWAL_STORE_HASH, otherwise the
+//partial hash (the control byte with JADWAL_GROUP_PROBE), an iterator holds on to it so that jadwal_remove_iter() can
+//tell when the bucket got another element
+static size_t jadwal_bucket_check_hash__(struct jadwal *ht, long idx) {
+#if defined(JADWAL_STORE_HASH)
+    return *jadwal_hash_at(ht, idx);
+#elif defined(JADWAL_GROUP_PROBE)
+    return ht->ctrl[idx];
+#else
+    return jadwal_pair_get_partial_hash(jadwal_pair_data_at(ht, idx));
+#endif
+}
+
+//the full hash of the element in the occupied bucket idx, without calling jadwal_hash() with JADWAL_STORE_HASH
+static size_t jadwal_bucket_hash__(struct jadwal *ht, long idx) {
+#if defined(JADWAL_STORE_HASH)
+    return *jadwal_hash_at(ht, idx);
+#else
+    return jadwal_key_hash__(ht, jadwal_key_at(ht, idx));
+#endif
+}
+
+//like jadwal_find_pos__ for a key that is known not to be in the table, no key comparisons, returns where it goes
+//(for JADWAL_HOPSCOTCH that is the home bucket, jadwal_hop_make_room__ does the rest)
+static long jadwal_find_free_pos__(struct jadwal *ht, size_t full_hash) {
+    JADWAL_ASSERT(jadwal_n_empty_buckets(ht) >= 1, "precondition violated, this leads to an infinite loop");
+    long idx = jadwal_integer_mod_buckets(ht, full_hash);
+#if defined(JADWAL_GROUP_PROBE)
+    while (1) {
+        jadwal_group_mask free_mask = jadwal_group_match_free(ht->ctrl + idx);
+        if (free_mask)
+            return jadwal_group_idx_mod_buckets(ht, idx + jadwal_group_mask_first(free_mask));
+        idx = jadwal_group_idx_mod_buckets(ht, idx + JADWAL_GROUP_WIDTH);
+    }
+#elif defined(JADWAL_HOPSCOTCH)
+    return idx;
+#elif defined(JADWAL_ROBIN_HOOD)
+    for (long dist = 0; ; dist++) {
+        unsigned int *pair_data = jadwal_pair_data_at(ht, idx);
+        if (jadwal_pair_is_empty(pair_data) || jadwal_pair_get_dist(pair_data) < dist)
+            return idx;
+        idx = jadwal_idx_mod_buckets(ht, idx + 1);
+    }
+#else
+    long step = jadwal_probe_step(ht, full_hash);
+    for (long i = 0; jadwal_slot_is_occupied(ht, idx); i++)
+        idx = jadwal_probe_next(ht, idx, i, step);
+    return idx;
+#endif
+}
+
+#ifndef JADWAL_REHASH_BATCH
+#define JADWAL_REHASH_BATCH 16
+#endif
+#if JADWAL_REHASH_BATCH < 1
+#error "JADWAL_REHASH_BATCH must be at least 1"
+#endif
+#ifndef JADWAL_FIND_BATCH
+#define JADWAL_FIND_BATCH 16
+#endif
+#if JADWAL_FIND_BATCH < 1
+#error "JADWAL_FIND_BATCH must be at least 1"
+#endif
+#ifndef JADWAL_INSERT_BATCH
+#define JADWAL_INSERT_BATCH 4096
+#endif
+#if JADWAL_INSERT_BATCH < 1
+#error "JADWAL_INSERT_BATCH must be at least 1"
+#endif
 
 //fwddecl
 static int jadwal_init_copy_settings(struct jadwal *ht, long initial_nelements, const struct jadwal *source);
 static int jadwal_insert(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value);
+static int jadwal_insert_unique__(struct jadwal *ht, size_t full_hash, jadwal_key_type *key, jadwal_value_type *value);
+static void jadwal_mark_as_empty__(struct jadwal *ht, long at_index);
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+static void jadwal_purge_tombstones__(struct jadwal *ht);
+#endif
+#ifdef JADWAL_INCREMENTAL
+static int jadwal_start_migration__(struct jadwal *ht);
+static int jadwal_migrate_key__(struct jadwal *ht, jadwal_key_type *key, size_t full_hash);
+#endif
 
 static bool jadwal_index_within(long start_idx, long cursor_idx, long end_idx_inclusive) {
     if ((start_idx <= end_idx_inclusive && cursor_idx >  end_idx_inclusive                             ) ||
@@ -553,8 +1752,7 @@ static long jadwal_skip_to_next__(struct jadwal *ht, long start_idx, long cursor
     JADWAL_ASSERT(cursor_idx >= 0  &&  cursor_idx < ht->nbuckets, "");
     JADWAL_ASSERT(start_idx >= 0  &&  start_idx < ht->nbuckets, "");
     for (long i=0; i<ht->nbuckets; i++) {
-        struct jadwal_pair_type *pair = ht->tab + cursor_idx;
-        if (jadwal_pair_is_occupied(pair)) {
+        if (jadwal_slot_is_occupied(ht, cursor_idx)) {
             return cursor_idx;
         }
         cursor_idx = jadwal_idx_mod_buckets(ht, cursor_idx + 1); 
@@ -564,94 +1762,444 @@ static long jadwal_skip_to_next__(struct jadwal *ht, long start_idx, long cursor
     return JADWAL_INVALID_TABLE_STATE;
 }
 
+//hints that the bucket idx is about to be written (the parts of it a probe touches)
+static void jadwal_prefetch_bucket__(struct jadwal *ht, long idx) {
+#if defined(__GNUC__) && !defined(JADWAL_NO_PREFETCH)
+  #if defined(JADWAL_GROUP_PROBE)
+    __builtin_prefetch(ht->ctrl + idx, 1);
+  #elif defined(JADWAL_SOA)
+    __builtin_prefetch(ht->pair_data + idx, 1);
+  #endif
+    __builtin_prefetch(jadwal_key_at(ht, idx), 1);
+#else
+    (void) ht;
+    (void) idx;
+#endif
+}
+
+//same for a bucket that is about to be looked up, plus the hopscotch bitmap of it
+static void jadwal_prefetch_bucket_read__(struct jadwal *ht, long idx) {
+#if defined(__GNUC__) && !defined(JADWAL_NO_PREFETCH)
+  #if defined(JADWAL_GROUP_PROBE)
+    __builtin_prefetch(ht->ctrl + idx, 0);
+  #elif defined(JADWAL_SOA)
+    __builtin_prefetch(ht->pair_data + idx, 0);
+  #endif
+  #ifdef JADWAL_HOPSCOTCH
+    __builtin_prefetch(ht->hop + idx, 0);
+  #endif
+    __builtin_prefetch(jadwal_key_at(ht, idx), 0);
+#else
+    (void) ht;
+    (void) idx;
+#endif
+}
+
+#ifdef JADWAL_PREFETCH_KEY
+//the first bucket a lookup of full_hash compares against (if its partial hash / control byte matches), prefetches what
+//the key stored there points to, the bucket itself should have been prefetched a while before
+static void jadwal_prefetch_home_key__(struct jadwal *ht, size_t full_hash) {
+    long idx = jadwal_integer_mod_buckets(ht, full_hash);
+#if defined(JADWAL_GROUP_PROBE)
+    jadwal_group_mask match = jadwal_group_match(ht->ctrl + idx, jadwal_hash_to_ctrl_tag(full_hash));
+    if (!match)
+        return;
+    idx = jadwal_group_idx_mod_buckets(ht, idx + jadwal_group_mask_first(match));
+#else
+  #if defined(JADWAL_HOPSCOTCH)
+    jadwal_hop_mask hop = ht->hop[idx];
+    if (!hop)
+        return;
+    idx = jadwal_hop_wrap__(ht, idx + jadwal_hop_first(hop));
+  #endif
+    if (!jadwal_slot_is_occupied(ht, idx) ||
+        jadwal_pair_get_partial_hash(jadwal_pair_data_at(ht, idx)) != jadwal_hash_to_partial_hash(full_hash))
+        return;
+#endif
+    JADWAL_PREFETCH_KEY(jadwal_key_at(ht, idx));
+}
+#endif
+
+//moves every element of source into destination, which must be freshly initialized (no tombstones, big enough)
+//the source buckets are walked in order, the elements are taken JADWAL_REHASH_BATCH at a time: first their hashes are
+//computed (or read, with JADWAL_STORE_HASH) and their destination buckets prefetched, then they're placed with
+//jadwal_insert_unique__ which only looks for a free bucket, no resize checks, no key comparisons, no tombstones
 static int jadwal_copy_all_to(struct jadwal *destination, struct jadwal *source) {
     JADWAL_ASSERT(destination != source && source && destination, "");
-    int rv;
-    long idx = jadwal_skip_to_next__(source, 0, JADWAL_ITER_FIRST, source->nbuckets - 1);
-    while (idx >= 0) {
-        struct jadwal_pair_type *pair = source->tab + idx;
-        rv = jadwal_insert(destination, &pair->key, &pair->value);
-        if (rv != JADWAL_OK)
-            return rv; //failed in middle of copying
-        idx = jadwal_skip_to_next__(source, 0, idx, source->nbuckets - 1);
+    JADWAL_ASSERT(destination->ndeleted == 0, "the destination must be a clean table");
+    long batch_idx[JADWAL_REHASH_BATCH];
+    size_t batch_hash[JADWAL_REHASH_BATCH];
+    long idx = 0;
+    while (idx < source->nbuckets) {
+        int n = 0;
+        for (; n < JADWAL_REHASH_BATCH && idx < source->nbuckets; idx++) {
+            if (!jadwal_slot_is_occupied(source, idx))
+                continue;
+            size_t full_hash = jadwal_bucket_hash__(source, idx);
+            jadwal_prefetch_bucket__(destination, jadwal_integer_mod_buckets(destination, full_hash));
+            batch_idx[n] = idx;
+            batch_hash[n] = full_hash;
+            n++;
+        }
+        for (int i = 0; i < n; i++) {
+            jadwal_key_type *key = jadwal_key_at(source, batch_idx[i]);
+            jadwal_value_type *value = jadwal_value_at(source, batch_idx[i]);
+            int rv = jadwal_insert_unique__(destination, batch_hash[i], key, value);
+            if (rv == JADWAL_NOT_FOUND) //robin hood / hopscotch limits, let the normal path grow the destination
+                rv = jadwal_insert(destination, key, value);
+            if (rv != JADWAL_OK)
+                return rv; //failed in middle of copying
+        }
     }
-    if (idx != JADWAL_ITER_STOP)
-        return (int) idx; //failed somehow
     return JADWAL_OK;
 }
 
-static int jadwal_resize__(struct jadwal *ht, long new_element_count) {
-
+//the size to pass to jadwal_init_copy_settings() when resizing for new_element_count, 0 if there's no point in resizing
+static long jadwal_resize_nbuckets__(struct jadwal *ht, long new_element_count) {
     long new_bucket_count = jadwal_calc_nelements_to_nbuckets(new_element_count, ht->shrink_at_percentage, ht->grow_at_percentage);
-    if (ht->nbuckets_po2 == jadwal_get_jprimes_power_idx(new_bucket_count)) {
-        return JADWAL_OK; 
+    //with tiny power of two tables the calculation can land back on the current size (3 elements fit 4 buckets at 85%,
+    //but 4 buckets at 85% grow at 3), when growing always move up a size class so the table never fills up
+    if (new_element_count >= ht->grow_at_gt_n && new_bucket_count <= ht->nbuckets)
+        new_bucket_count = ht->nbuckets + 1;
+    if (ht->nbuckets_po2 == jadwal_get_size_class(new_bucket_count)) {
+        return 0; 
         //because we use primes, for some reason both new value and old values map to the same power of two
         //and there is no point in resizing, since this is an approximate thing it's not a big deal
     }
     JADWAL_ASSERT(new_bucket_count > JADWAL_MIN_TABLESIZE, "");
+    return new_bucket_count;
+}
+
+#ifdef JADWAL_PARALLEL_RESIZE
+struct jadwal_parallel_copy__ {
+    struct jadwal *destination;
+    struct jadwal *source;
+    long ntasks;
+};
+//places the element of the source bucket src_idx while other tasks do the same, an empty bucket of the destination is
+//claimed by swapping its state to occupied atomically, only then its owner writes the key and value
+//every bucket an element passes over is occupied for good, so lookups find it afterwards as usual
+static void jadwal_claim_and_place__(struct jadwal *destination, struct jadwal *source, long src_idx) {
+    size_t full_hash = jadwal_bucket_hash__(source, src_idx);
+    long idx = jadwal_integer_mod_buckets(destination, full_hash);
+#ifdef JADWAL_GROUP_PROBE
+    //one control byte at a time, in group order that is just linear, the mirrored bytes are written afterwards
+    unsigned char tag = jadwal_hash_to_ctrl_tag(full_hash);
+    while (1) {
+        unsigned char expected = JADWAL_CTRL_EMPTY;
+        if (__atomic_load_n(destination->ctrl + idx, __ATOMIC_RELAXED) == JADWAL_CTRL_EMPTY &&
+            __atomic_compare_exchange_n(destination->ctrl + idx, &expected, tag, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        idx = jadwal_idx_mod_buckets(destination, idx + 1);
+    }
+#else
+    unsigned int claimed = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY, jadwal_hash_to_partial_hash(full_hash));
+    long step = jadwal_probe_step(destination, full_hash);
+    for (long i = 0; ; i++) {
+        unsigned int *pair_data = jadwal_pair_data_at(destination, idx);
+        unsigned int expected = 0; //a fresh table is all zeroes
+        if (__atomic_load_n(pair_data, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(pair_data, &expected, claimed, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        idx = jadwal_probe_next(destination, idx, i, step);
+    }
+#endif
+#ifdef JADWAL_STORE_HASH
+    *jadwal_hash_at(destination, idx) = full_hash;
+#endif
+    memcpy(jadwal_key_at(destination, idx), jadwal_key_at(source, src_idx), sizeof(jadwal_key_type));
+    memcpy(jadwal_value_at(destination, idx), jadwal_value_at(source, src_idx), sizeof(jadwal_value_type));
+}
+static void jadwal_parallel_copy_task__(void *arg, long task_idx) {
+    struct jadwal_parallel_copy__ *copy = (struct jadwal_parallel_copy__ *) arg;
+    long nbuckets = copy->source->nbuckets;
+    long begin_idx = nbuckets * task_idx / copy->ntasks;
+    long end_idx = nbuckets * (task_idx + 1) / copy->ntasks;
+    for (long idx = begin_idx; idx < end_idx; idx++) {
+        if (jadwal_slot_is_occupied(copy->source, idx))
+            jadwal_claim_and_place__(copy->destination, copy->source, idx);
+    }
+}
+//jadwal_copy_all_to() with the source buckets split into ranges, one per task
+static int jadwal_copy_all_to_parallel__(struct jadwal *destination, struct jadwal *source) {
+    JADWAL_ASSERT(destination->nelements == 0 && destination->ndeleted == 0, "the destination must be a fresh table");
+    JADWAL_ASSERT(source->nelements < destination->nbuckets, "");
+    struct jadwal_parallel_copy__ copy = { destination, source, source->ntasks };
+    source->run_tasks(jadwal_parallel_copy_task__, &copy, copy.ntasks, source->userdata);
+#ifdef JADWAL_GROUP_PROBE
+    for (long i = 0; i < JADWAL_GROUP_WIDTH; i++)
+        destination->ctrl[destination->nbuckets + i] = destination->ctrl[i % destination->nbuckets];
+#endif
+    destination->nelements = source->nelements;
+    return JADWAL_OK;
+}
+
+#ifdef JADWAL_PTHREADS
+#include <pthread.h>
+struct jadwal_pthread_task__ {
+    jadwal_task_fptr task;
+    void *arg;
+    long task_idx;
+};
+static void *jadwal_pthread_main__(void *arg) {
+    struct jadwal_pthread_task__ *task = (struct jadwal_pthread_task__ *) arg;
+    task->task(task->arg, task->task_idx);
+    return NULL;
+}
+//a runner for jadwal_set_task_runner(), starts a thread for every task but the first, which the caller runs
+//if a thread can't be started its task runs on the calling thread
+static void jadwal_run_tasks_pthreads(jadwal_task_fptr task, void *arg, long ntasks, void *userdata) {
+    (void) userdata;
+    pthread_t threads[JADWAL_MAX_TASKS];
+    struct jadwal_pthread_task__ tasks[JADWAL_MAX_TASKS];
+    bool started[JADWAL_MAX_TASKS];
+    JADWAL_ASSERT(ntasks >= 1 && ntasks <= JADWAL_MAX_TASKS, "");
+    for (long i = 1; i < ntasks; i++) {
+        struct jadwal_pthread_task__ t = { task, arg, i };
+        tasks[i] = t;
+        started[i] = pthread_create(&threads[i], NULL, jadwal_pthread_main__, &tasks[i]) == 0;
+    }
+    task(arg, 0);
+    for (long i = 1; i < ntasks; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            task(arg, i);
+    }
+}
+#endif // JADWAL_PTHREADS
+#endif // JADWAL_PARALLEL_RESIZE
+
+static int jadwal_resize__(struct jadwal *ht, long new_element_count) {
+    long new_bucket_count = jadwal_resize_nbuckets__(ht, new_element_count);
+    if (new_bucket_count == 0)
+        return JADWAL_OK;
 
     struct jadwal new_ht;
     int rv = jadwal_init_copy_settings(&new_ht, new_bucket_count, ht);
     if (rv != JADWAL_OK) {
         return rv;
     }
+#ifdef JADWAL_PARALLEL_RESIZE
+    if (ht->run_tasks && ht->ntasks > 1 && ht->nelements >= JADWAL_PARALLEL_MIN)
+        rv = jadwal_copy_all_to_parallel__(&new_ht, ht);
+    else
+        rv = jadwal_copy_all_to(&new_ht, ht);
+#else
     rv = jadwal_copy_all_to(&new_ht, ht);
+#endif
     if (rv != JADWAL_OK) {
         jadwal_deinit(&new_ht);
         return rv;
     }
     JADWAL_ASSERT(new_ht.nelements == ht->nelements, "copying failed");
     JADWAL_ASSERT(new_ht.ndeleted == 0, "copying failed");
+#ifdef JADWAL_STATS
+    new_ht.stats = ht->stats; //the reinsertions above aren't lookups the user made
+#endif
 
     //swap and deinit
+#ifdef JADWAL_ARENA
+    jadwal_arena_move__(&new_ht, ht);
+#endif
+#ifdef JADWAL_INCREMENTAL
+    //this is also used in the middle of an incremental resize (robin hood / hopscotch limits), keep the old table
+    struct jadwal *old = ht->old;
+    long migrate_idx = ht->migrate_idx;
+    ht->old = NULL;
+    jadwal_deinit(ht);
+    memcpy(ht, &new_ht, sizeof *ht);
+    ht->old = old;
+    ht->migrate_idx = migrate_idx;
+#else
     jadwal_deinit(ht);
     memcpy(ht, &new_ht, sizeof *ht);
+#endif
 
     JADWAL_ASSERT(jadwal_dbg_sanity_heavy(ht), "");
 
     return JADWAL_OK;
 }
 
+static bool jadwal_at_insert_must_resize(struct jadwal *ht) {
+    //we need to have at least one empty bucket, otherwise we can run into an infinite loop while searching
+    return (jadwal_n_unused_buckets(ht) <= 1); 
+}
+
 enum jadwal_hint {
     JADWAL_HINT_NONE,
     JADWAL_HINT_INSERTING,
     JADWAL_HINT_DELETING,
 };
 static int jadwal_if_needed_try_resize(struct jadwal *ht, int hint) {
+#ifdef JADWAL_MANUAL_RESIZE
+    //the caller grows and purges, inserts only refuse to use up the last empty buckets
+    (void) hint;
+    if (jadwal_at_insert_must_resize(ht) || jadwal_n_empty_buckets(ht) <= 1)
+        return JADWAL_RESIZE_REFUSE;
+    return JADWAL_OK;
+#endif
     int rv = JADWAL_OK;
     //avoids trying to shrink when we're inserting, and avoids trying to grow when we're removing elements
     if (ht->nelements >= ht->grow_at_gt_n && (hint != JADWAL_HINT_DELETING)) {
+#ifdef JADWAL_INCREMENTAL
+        rv = jadwal_start_migration__(ht);
+#else
         rv = jadwal_resize__(ht, ht->nelements);
+#endif
     }
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+    //the element count alone misses tables that stay the same size under insert / remove churn, the tombstones pile up
+    //until probes get long (and with no empty bucket left a probe never ends), get rid of them without reallocating
+    else if (hint == JADWAL_HINT_INSERTING && ht->ndeleted > 0 &&
+             (ht->ndeleted > ht->purge_at_gt_n || jadwal_n_empty_buckets(ht) <= 1)) {
+        jadwal_purge_tombstones__(ht);
+    }
+#endif
     else if ((ht->nelements < ht->shrink_at_lt_n) && ((ht->nbuckets / 2) < JADWAL_MIN_TABLESIZE) && (hint != JADWAL_HINT_INSERTING)) {
         rv = jadwal_resize__(ht, ht->nelements);
     }
     return rv;
 }
-static bool jadwal_at_insert_must_resize(struct jadwal *ht) {
-    //we need to have at least one empty bucket, otherwise we can run into an infinite loop while searching
-    return (jadwal_n_unused_buckets(ht) <= 1); 
+
+#if defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_HOPSCOTCH)
+//copies the whole bucket (pair_data, key, value) from src_idx to dst_idx
+static void jadwal_move_bucket__(struct jadwal *ht, long dst_idx, long src_idx) {
+#ifdef JADWAL_SOA
+    ht->pair_data[dst_idx] = ht->pair_data[src_idx];
+  #ifdef JADWAL_STORE_HASH
+    ht->hashes[dst_idx] = ht->hashes[src_idx];
+  #endif
+    memcpy(ht->keys + dst_idx, ht->keys + src_idx, sizeof(jadwal_key_type));
+    memcpy(ht->values + dst_idx, ht->values + src_idx, sizeof(jadwal_value_type));
+#else
+    memcpy(ht->tab + dst_idx, ht->tab + src_idx, sizeof(struct jadwal_pair_type));
+#endif
 }
+#endif
 
-//clears flags, makes it occupied, copies key and value to it
-static int jadwal_set_pair_at_pos__(struct jadwal *ht, size_t full_hash, jadwal_key_type *key, jadwal_value_type *value, long place_to_insert_idx) {
-    JADWAL_ASSERT(ht->nelements < ht->nbuckets, "");
+#ifdef JADWAL_ROBIN_HOOD
+//how far idx is from the bucket full_hash maps to
+static long jadwal_rh_dist__(struct jadwal *ht, size_t full_hash, long idx) {
+    long dist = idx - jadwal_integer_mod_buckets(ht, full_hash);
+    if (dist < 0)
+        dist += ht->nbuckets;
+    return dist;
+}
+//checks that inserting at idx (as returned by jadwal_find_pos__) keeps every probe distance within JADWAL_RH_MAX_DIST
+static bool jadwal_rh_can_insert_at__(struct jadwal *ht, size_t full_hash, long idx) {
+    if (jadwal_rh_dist__(ht, full_hash, idx) > JADWAL_RH_MAX_DIST)
+        return false;
+    //the buckets from idx until the end of the run will be shifted forward by one
+    for (; !jadwal_slot_is_empty(ht, idx); idx = jadwal_idx_mod_buckets(ht, idx + 1)) {
+        if (jadwal_pair_get_dist(jadwal_pair_data_at(ht, idx)) >= JADWAL_RH_MAX_DIST)
+            return false;
+    }
+    return true;
+}
+//makes room at idx by moving the rest of the run one bucket forward
+static void jadwal_rh_shift_forward__(struct jadwal *ht, long idx) {
+    long end_idx = idx;
+    while (!jadwal_slot_is_empty(ht, end_idx))
+        end_idx = jadwal_idx_mod_buckets(ht, end_idx + 1);
+    while (end_idx != idx) {
+        long prev_idx = jadwal_idx_mod_buckets(ht, end_idx - 1);
+        jadwal_move_bucket__(ht, end_idx, prev_idx);
+        unsigned int *pair_data = jadwal_pair_data_at(ht, end_idx);
+        jadwal_pair_set_dist(pair_data, jadwal_pair_get_dist(pair_data) + 1);
+        end_idx = prev_idx;
+    }
+}
+//backward shift deletion, pulls the rest of the run one bucket back over idx, so no tombstone is needed
+static void jadwal_rh_remove_at__(struct jadwal *ht, long idx) {
+    long next_idx = jadwal_idx_mod_buckets(ht, idx + 1);
+    while (jadwal_slot_is_occupied(ht, next_idx) && jadwal_pair_get_dist(jadwal_pair_data_at(ht, next_idx)) > 0) {
+        jadwal_move_bucket__(ht, idx, next_idx);
+        unsigned int *pair_data = jadwal_pair_data_at(ht, idx);
+        jadwal_pair_set_dist(pair_data, jadwal_pair_get_dist(pair_data) - 1);
+        idx = next_idx;
+        next_idx = jadwal_idx_mod_buckets(ht, idx + 1);
+    }
+    jadwal_mark_as_empty__(ht, idx);
+}
+#endif // JADWAL_ROBIN_HOOD
+
+#ifdef JADWAL_HOPSCOTCH
+//finds the first empty bucket after home, then moves it back towards home by moving elements that sit before it
+//into it (each one stays within its own neighbourhood), until it is less than JADWAL_HOP_RANGE buckets from home
+//on success the bucket is marked in home's bitmap and returned, the caller fills it
+//returns JADWAL_NOT_FOUND if no element could be moved, the table has to grow then (elements moved so far stay valid)
+static long jadwal_hop_make_room__(struct jadwal *ht, long home) {
+    long free_idx = home;
+    long dist = 0;
+    while (!jadwal_slot_is_empty(ht, free_idx)) {
+        //terminates, jadwal_find_pos__ checked that there is an empty bucket
+        free_idx = jadwal_idx_mod_buckets(ht, free_idx + 1);
+        dist++;
+    }
+    while (dist >= JADWAL_HOP_RANGE) {
+        //the candidate homes furthest back first, they move the empty bucket back the most
+        bool moved = false;
+        for (long back = JADWAL_HOP_RANGE - 1; back > 0 && !moved; back--) {
+            long cand_home = jadwal_hop_wrap__(ht, free_idx - back);
+            //only elements between cand_home and free_idx
+            jadwal_hop_mask hop = ht->hop[cand_home] & (((jadwal_hop_mask) 1 << back) - 1);
+            if (!hop)
+                continue;
+            long offset = jadwal_hop_first(hop);
+            long src_idx = jadwal_hop_wrap__(ht, cand_home + offset);
+            jadwal_move_bucket__(ht, free_idx, src_idx);
+            jadwal_mark_as_empty__(ht, src_idx);
+            ht->hop[cand_home] = (ht->hop[cand_home] & ~((jadwal_hop_mask) 1 << offset)) | ((jadwal_hop_mask) 1 << back);
+            dist -= back - offset;
+            free_idx = src_idx;
+            moved = true;
+        }
+        if (!moved)
+            return JADWAL_NOT_FOUND;
+    }
+    ht->hop[home] |= (jadwal_hop_mask) 1 << dist;
+    return free_idx;
+}
+#endif // JADWAL_HOPSCOTCH
+
+//clears flags, makes it occupied by an element with full_hash (the key and value aren't touched)
+static void jadwal_set_occupied__(struct jadwal *ht, size_t full_hash, long place_to_insert_idx) {
     JADWAL_ASSERT(place_to_insert_idx >= 0 && place_to_insert_idx < ht->nbuckets , "");
-    struct jadwal_pair_type *pair = ht->tab + place_to_insert_idx;
-    pair->pair_data = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY, //flags
+#ifdef JADWAL_GROUP_PROBE
+    jadwal_set_ctrl(ht, place_to_insert_idx, jadwal_hash_to_ctrl_tag(full_hash));
+#else
+    unsigned int *pair_data = jadwal_pair_data_at(ht, place_to_insert_idx);
+    *pair_data = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY, //flags
                                                         jadwal_hash_to_partial_hash(full_hash));
-    memcpy(&pair->key, key, sizeof *key);
-    memcpy(&pair->value, value, sizeof *value);
+  #ifdef JADWAL_ROBIN_HOOD
+    jadwal_pair_set_dist(pair_data, jadwal_rh_dist__(ht, full_hash, place_to_insert_idx));
+  #endif
+#endif
+#ifdef JADWAL_STORE_HASH
+    *jadwal_hash_at(ht, place_to_insert_idx) = full_hash;
+#endif
+}
+//clears flags, makes it occupied, copies key and value to it (a NULL value is zeroed instead)
+static int jadwal_set_pair_at_pos__(struct jadwal *ht, size_t full_hash, jadwal_key_type *key, jadwal_value_type *value, long place_to_insert_idx) {
+    JADWAL_ASSERT(ht->nelements < ht->nbuckets, "");
+    jadwal_set_occupied__(ht, full_hash, place_to_insert_idx);
+    memcpy(jadwal_key_at(ht, place_to_insert_idx), key, sizeof *key);
+    if (value)
+        memcpy(jadwal_value_at(ht, place_to_insert_idx), value, sizeof *value);
+    else
+        memset(jadwal_value_at(ht, place_to_insert_idx), 0, sizeof(jadwal_value_type));
     return JADWAL_OK;
 }
 
-static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, long *found_idx_out, bool or_replace) {
+static int jadwal_insert_hashed__(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, size_t full_hash,
+                                  long *found_idx_out, bool or_replace) {
     JADWAL_ASSERT(jadwal_dbg_sanity_01(ht), "jadwal corrupt or not initialized");
     JADWAL_ASSERT(ht->nelements < ht->nbuckets, "");
     JADWAL_ASSERT(found_idx_out, "");
     long found_idx;
     int rv = jadwal_if_needed_try_resize(ht, JADWAL_HINT_INSERTING);
-    if (rv != JADWAL_OK && jadwal_at_insert_must_resize(ht)) {
+    if (rv == JADWAL_RESIZE_REFUSE || (rv != JADWAL_OK && jadwal_at_insert_must_resize(ht))) {
         //failed, translate the error
         if (rv == JADWAL_INVALID_TABLE_STATE || rv == JADWAL_ALLOC_ERR)
             return rv;
@@ -659,8 +2207,40 @@ static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value
             return JADWAL_FAILED_AT_RESIZE;
     }
 
-    size_t full_hash;
-    rv = jadwal_find_pos__(ht, key, &found_idx, &full_hash);
+#ifdef JADWAL_INCREMENTAL
+    //a key that is still in the old table is moved first, it is then found below as a duplicate
+    rv = jadwal_migrate_key__(ht, key, full_hash);
+    if (rv != JADWAL_OK) {
+        *found_idx_out = JADWAL_NOT_FOUND;
+        return rv;
+    }
+#endif
+    rv = jadwal_find_pos_hashed__(ht, key, full_hash, &found_idx);
+
+#ifdef JADWAL_ROBIN_HOOD
+    while (rv == JADWAL_NOT_FOUND && !jadwal_rh_can_insert_at__(ht, full_hash, found_idx)) {
+        //a probe distance wouldn't fit in pair_data, grow the table and look again
+        long nbuckets_before = ht->nbuckets;
+        rv = jadwal_resize__(ht, ht->nbuckets);
+        if (rv != JADWAL_OK || ht->nbuckets == nbuckets_before) {
+            *found_idx_out = JADWAL_NOT_FOUND;
+            return rv == JADWAL_ALLOC_ERR ? rv : JADWAL_FAILED_AT_RESIZE;
+        }
+        rv = jadwal_find_pos_hashed__(ht, key, full_hash, &found_idx);
+    }
+#endif
+#ifdef JADWAL_HOPSCOTCH
+    while (rv == JADWAL_NOT_FOUND && (found_idx = jadwal_hop_make_room__(ht, found_idx)) == JADWAL_NOT_FOUND) {
+        //no empty bucket could be brought into the neighbourhood, grow the table and look again
+        long nbuckets_before = ht->nbuckets;
+        rv = jadwal_resize__(ht, ht->nbuckets);
+        if (rv != JADWAL_OK || ht->nbuckets == nbuckets_before) {
+            *found_idx_out = JADWAL_NOT_FOUND;
+            return rv == JADWAL_ALLOC_ERR ? rv : JADWAL_FAILED_AT_RESIZE;
+        }
+        rv = jadwal_find_pos_hashed__(ht, key, full_hash, &found_idx);
+    }
+#endif
 
     if (found_idx == JADWAL_NOT_FOUND) {
         //weird error, we were expecting either:
@@ -677,11 +2257,14 @@ static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value
     }
     else if (rv == JADWAL_NOT_FOUND) {
         //not a duplicate, new element
-        struct jadwal_pair_type *pair = ht->tab + found_idx; 
-        if (jadwal_pair_is_deleted(pair)) {
+#ifdef JADWAL_ROBIN_HOOD
+        jadwal_rh_shift_forward__(ht, found_idx);
+#else
+        if (jadwal_slot_is_deleted(ht, found_idx)) {
             JADWAL_ASSERT(ht->ndeleted > 0, "found a deleted element even though ht->ndeleted <= 0");
             ht->ndeleted--;
         }
+#endif
         ht->nelements++;
     }
     else if (rv != JADWAL_OK) {
@@ -694,6 +2277,9 @@ static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value
     *found_idx_out = found_idx;
     return rv;
 }
+static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, long *found_idx_out, bool or_replace) {
+    return jadwal_insert_hashed__(ht, key, value, jadwal_key_hash__(ht, key), found_idx_out, or_replace);
+}
 
 
 //this only happens when we delete an element where the one next to it is empty:
@@ -703,52 +2289,109 @@ static int jadwal_insert__(struct jadwal *ht, jadwal_key_type *key, jadwal_value
 // [filled] [filled] [filled and to be deleted] [filled or deleted] [filled] [empty]
 //                    ^^^mark as deleted^^^^     ^next^
 static void jadwal_mark_as_empty__(struct jadwal *ht, long at_index) {
-    struct jadwal_pair_type *pair = ht->tab + at_index; 
-    JADWAL_ASSERT(!jadwal_pair_is_empty(pair), "");
-    jadwal_pair_set_flags(pair,
-                  (jadwal_pair_flags(pair) & (~ (JADWAL_VLT_IS_NOT_EMPTY | JADWAL_VLT_IS_DELETED))));
-    JADWAL_ASSERT(jadwal_pair_is_empty(pair), "");
+    JADWAL_ASSERT(!jadwal_slot_is_empty(ht, at_index), "");
+#ifdef JADWAL_GROUP_PROBE
+    jadwal_set_ctrl(ht, at_index, JADWAL_CTRL_EMPTY);
+#else
+    unsigned int *pair_data = jadwal_pair_data_at(ht, at_index); 
+    jadwal_pair_set_flags(pair_data,
+                  (jadwal_pair_flags(pair_data) & (~ (JADWAL_VLT_IS_NOT_EMPTY | JADWAL_VLT_IS_DELETED))));
+#endif
+    JADWAL_ASSERT(jadwal_slot_is_empty(ht, at_index), "");
 }
+#ifndef JADWAL_GROUP_PROBE
+//not available with control bytes, the partial hash is lost once the bucket is emptied
 static void jadwal_mark_as_occupied__(struct jadwal *ht, long at_index) {
-    struct jadwal_pair_type *pair = ht->tab + at_index; 
-    JADWAL_ASSERT(jadwal_pair_is_empty(pair) || jadwal_pair_is_deleted(pair), "");
-    jadwal_pair_set_flags(pair,
-                  (jadwal_pair_flags(pair) & (~JADWAL_VLT_IS_DELETED)) | JADWAL_VLT_IS_NOT_EMPTY);
-    JADWAL_ASSERT(!jadwal_pair_is_empty(pair), "");
+    unsigned int *pair_data = jadwal_pair_data_at(ht, at_index); 
+    JADWAL_ASSERT(jadwal_pair_is_empty(pair_data) || jadwal_pair_is_deleted(pair_data), "");
+    jadwal_pair_set_flags(pair_data,
+                  (jadwal_pair_flags(pair_data) & (~JADWAL_VLT_IS_DELETED)) | JADWAL_VLT_IS_NOT_EMPTY);
+    JADWAL_ASSERT(!jadwal_pair_is_empty(pair_data), "");
 }
+#endif
 static void jadwal_mark_as_deleted__(struct jadwal *ht, long at_index) {
-    struct jadwal_pair_type *pair = ht->tab + at_index; 
-    JADWAL_ASSERT(jadwal_pair_is_occupied(pair), "trying to delete an empty element");
-    jadwal_pair_set_flags(pair,
-                  jadwal_pair_flags(pair) | JADWAL_VLT_IS_DELETED);
-    JADWAL_ASSERT(jadwal_pair_is_deleted(pair), "");
+    JADWAL_ASSERT(jadwal_slot_is_occupied(ht, at_index), "trying to delete an empty element");
+#ifdef JADWAL_GROUP_PROBE
+    jadwal_set_ctrl(ht, at_index, JADWAL_CTRL_DELETED);
+#else
+    unsigned int *pair_data = jadwal_pair_data_at(ht, at_index); 
+    jadwal_pair_set_flags(pair_data,
+                  jadwal_pair_flags(pair_data) | JADWAL_VLT_IS_DELETED);
+#endif
+    JADWAL_ASSERT(jadwal_slot_is_deleted(ht, at_index), "");
 }
 
-static int jadwal_remove(struct jadwal *ht, jadwal_key_type *key) {
-    long found_idx;
-    size_t full_hash;
-    int rv = jadwal_find_pos__(ht, key, &found_idx, &full_hash);
-    if (rv == JADWAL_NOT_FOUND) {
-        return rv;
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+//rehashes the table within its own buckets, afterwards there are no tombstones (ndeleted is 0)
+//first every tombstone becomes empty and every element is marked deleted, which here means "not placed yet", then each
+//unplaced element goes to the first free bucket of its probe sequence, if that bucket holds another unplaced element
+//the two are swapped and the one that came back is placed next
+//an element never lands past a bucket that is free at that time, so emptying the bucket it came from is safe
+static void jadwal_purge_tombstones__(struct jadwal *ht) {
+    for (long idx = 0; idx < ht->nbuckets; idx++) {
+        if (jadwal_slot_is_deleted(ht, idx))
+            jadwal_mark_as_empty__(ht, idx);
+        else if (jadwal_slot_is_occupied(ht, idx))
+            jadwal_mark_as_deleted__(ht, idx);
     }
-    else if (rv != JADWAL_OK) {
-        //failed, TODO: check what's the error
-        return rv;
+    ht->ndeleted = 0;
+    for (long idx = 0; idx < ht->nbuckets; idx++) {
+        while (jadwal_slot_is_deleted(ht, idx)) {
+            size_t full_hash = jadwal_bucket_hash__(ht, idx);
+            long target = jadwal_find_free_pos__(ht, full_hash);
+            if (target == idx) {
+                jadwal_set_occupied__(ht, full_hash, idx);
+            }
+            else if (jadwal_slot_is_empty(ht, target)) {
+                jadwal_set_pair_at_pos__(ht, full_hash, jadwal_key_at(ht, idx), jadwal_value_at(ht, idx), target);
+                jadwal_mark_as_empty__(ht, idx);
+            }
+            else {
+                //target isn't placed yet either, swap and keep going with what is now at idx
+                jadwal_key_type key;
+                jadwal_value_type value;
+                memcpy(&key, jadwal_key_at(ht, idx), sizeof key);
+                memcpy(&value, jadwal_value_at(ht, idx), sizeof value);
+                memcpy(jadwal_key_at(ht, idx), jadwal_key_at(ht, target), sizeof key);
+                memcpy(jadwal_value_at(ht, idx), jadwal_value_at(ht, target), sizeof value);
+#ifdef JADWAL_STORE_HASH
+                *jadwal_hash_at(ht, idx) = *jadwal_hash_at(ht, target);
+#endif
+                jadwal_set_pair_at_pos__(ht, full_hash, &key, &value, target);
+            }
+        }
     }
-    JADWAL_ASSERT(found_idx >= 0 && found_idx < ht->nbuckets, "find pos returned invalid index");
-#ifdef JADWAL_DBG
-        struct jadwal_pair_type *pair = ht->tab + found_idx;
-        JADWAL_ASSERT(jadwal_pair_is_occupied(pair), "find pos returned an index of a deleted/empty element");
-#endif // JADWAL_DBG
+    JADWAL_ASSERT(jadwal_dbg_sanity_heavy(ht), "");
+}
+#endif
 
+//removes the element in the occupied bucket found_idx, full_hash is its hash (only hopscotch needs it)
+static int jadwal_remove_at__(struct jadwal *ht, long found_idx, size_t full_hash) {
+    (void) full_hash;
+    JADWAL_ASSERT(found_idx >= 0 && found_idx < ht->nbuckets, "find pos returned invalid index");
+    JADWAL_ASSERT(jadwal_slot_is_occupied(ht, found_idx), "find pos returned an index of a deleted/empty element");
+
+#if defined(JADWAL_ROBIN_HOOD)
+    jadwal_rh_remove_at__(ht, found_idx);
+#elif defined(JADWAL_HOPSCOTCH)
+    //nothing else is affected, just drop the bucket from its home's bitmap
+    long home = jadwal_integer_mod_buckets(ht, full_hash);
+    long dist = jadwal_hop_wrap__(ht, found_idx - home);
+    JADWAL_ASSERT(ht->hop[home] & ((jadwal_hop_mask) 1 << dist), "hop bitmap out of sync");
+    ht->hop[home] &= ~((jadwal_hop_mask) 1 << dist);
+    jadwal_mark_as_empty__(ht, found_idx);
+#elif defined(JADWAL_PROBE_NONLINEAR)
+    //an empty neighbour says nothing about the probe sequences that pass through found_idx, so it always becomes a tombstone
+    jadwal_mark_as_deleted__(ht, found_idx);
+    ht->ndeleted++;
+#else
     //optimization: if next element is empty, mark our element as empty too, otherwise mark our element as deleted
     //TODO: benchmark this
     long next_idx = jadwal_idx_mod_buckets(ht, found_idx + 1); //this assumes linear probing
-    struct jadwal_pair_type *next_pair = ht->tab + next_idx;
     //TODO, division even though it is fast can be optimized to be a branch in wrap around cases
     //After benchmarking this, the results were: cleaning up in general made things faster by 2.0%
     //JADWAL_AGRESSIVE_CLEANUP made things faster by about 0.5% (which is insignificant)
-    if (jadwal_pair_is_empty(next_pair)) {
+    if (jadwal_slot_is_empty(ht, next_idx)) {
         jadwal_mark_as_empty__(ht, found_idx);
 
         //^TODO: add tests that extensively test the table state after lots of deletions
@@ -772,12 +2415,10 @@ static int jadwal_remove(struct jadwal *ht, jadwal_key_type *key) {
         #define JADWAL_AGRESSIVE_CLEANUP
         #ifdef JADWAL_AGRESSIVE_CLEANUP
             long prev_idx = jadwal_idx_mod_buckets(ht, found_idx - 1);
-            struct jadwal_pair_type *prev_pair = ht->tab + prev_idx;
-            while (jadwal_pair_is_deleted(prev_pair)) {
+            while (jadwal_slot_is_deleted(ht, prev_idx)) {
                 jadwal_mark_as_empty__(ht, prev_idx);
-                JADWAL_ASSERT(jadwal_pair_is_empty(prev_pair), "");
+                ht->ndeleted--;
                 prev_idx = jadwal_idx_mod_buckets(ht, prev_idx - 1); 
-                prev_pair = ht->tab + prev_idx;
             }
         #else
             long supposed_to_be_in_idx = jadwal_integer_mod_buckets(ht, full_hash);
@@ -785,12 +2426,10 @@ static int jadwal_remove(struct jadwal *ht, jadwal_key_type *key) {
             if (probe_len < 0)
                 probe_len = probe_len + ht->nbuckets;
             long prev_idx = jadwal_idx_mod_buckets(ht, found_idx - 1);
-            struct jadwal_pair_type *prev_pair = ht->tab + prev_idx;
-            for (long i = 0; i < probe_len && jadwal_pair_is_deleted(prev_pair); i++) {
+            for (long i = 0; i < probe_len && jadwal_slot_is_deleted(ht, prev_idx); i++) {
                 jadwal_mark_as_empty__(ht, prev_idx);
-                JADWAL_ASSERT(jadwal_pair_is_empty(prev_pair), "");
+                ht->ndeleted--;
                 prev_idx = jadwal_idx_mod_buckets(ht, prev_idx - 1); 
-                prev_pair = ht->tab + prev_idx;
             }
         #endif // JADWAL_AGRESSIVE_CLEANUP
     }
@@ -798,36 +2437,260 @@ static int jadwal_remove(struct jadwal *ht, jadwal_key_type *key) {
         jadwal_mark_as_deleted__(ht, found_idx);
         ht->ndeleted++;
     }
+#endif // JADWAL_ROBIN_HOOD
 
     ht->nelements--;
     return JADWAL_OK;
 }
+//jadwal_remove() with the hash of the key already computed (it must be what jadwal_hash() returns for it)
+static int jadwal_remove_hashed(struct jadwal *ht, jadwal_key_type *key, size_t full_hash) {
+    JADWAL_ASSERT(full_hash == jadwal_key_hash__(ht, key), "the hash passed isn't the hash of the key");
+    long found_idx;
+    int rv;
+#ifdef JADWAL_INCREMENTAL
+    rv = jadwal_migrate_key__(ht, key, full_hash);
+    if (rv != JADWAL_OK)
+        return rv;
+#endif
+    rv = jadwal_find_pos_hashed__(ht, key, full_hash, &found_idx);
+    if (rv == JADWAL_NOT_FOUND) {
+        return rv;
+    }
+    else if (rv != JADWAL_OK) {
+        //failed, TODO: check what's the error
+        return rv;
+    }
+    return jadwal_remove_at__(ht, found_idx, full_hash);
+}
+static int jadwal_remove(struct jadwal *ht, jadwal_key_type *key) {
+    return jadwal_remove_hashed(ht, key, jadwal_key_hash__(ht, key));
+}
+//inserts a key that is known not to be in the table, with its hash already computed, without calling jadwal_hash()
+//or jadwal_key_eq_cmp() and without resizing, this is for moving elements into a new table
+//returns JADWAL_NOT_FOUND if the key can't be placed without growing (robin hood / hopscotch limits)
+static int jadwal_insert_unique__(struct jadwal *ht, size_t full_hash, jadwal_key_type *key, jadwal_value_type *value) {
+    JADWAL_ASSERT(jadwal_n_unused_buckets(ht) > 1, "the table must have been sized for the element");
+    long idx = jadwal_find_free_pos__(ht, full_hash);
+#if defined(JADWAL_ROBIN_HOOD)
+    if (!jadwal_rh_can_insert_at__(ht, full_hash, idx))
+        return JADWAL_NOT_FOUND;
+    jadwal_rh_shift_forward__(ht, idx);
+#elif defined(JADWAL_HOPSCOTCH)
+    idx = jadwal_hop_make_room__(ht, idx);
+    if (idx == JADWAL_NOT_FOUND)
+        return JADWAL_NOT_FOUND;
+#else
+    if (jadwal_slot_is_deleted(ht, idx))
+        ht->ndeleted--;
+#endif
+    ht->nelements++;
+    return jadwal_set_pair_at_pos__(ht, full_hash, key, value, idx);
+}
+
 static int jadwal_insert(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value) {
     long idx_unused;
     int rv = jadwal_insert__(ht, key, value, &idx_unused, false /*dont replace*/);
     return rv;
 }
+//jadwal_insert() with the hash of the key already computed (it must be what jadwal_hash() returns for it)
+static int jadwal_insert_hashed(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, size_t full_hash) {
+    JADWAL_ASSERT(full_hash == jadwal_key_hash__(ht, key), "the hash passed isn't the hash of the key");
+    long idx_unused;
+    return jadwal_insert_hashed__(ht, key, value, full_hash, &idx_unused, false /*dont replace*/);
+}
+
+#ifdef JADWAL_INCREMENTAL
+//moves the element in the bucket idx of the old table to ht, the old bucket becomes a tombstone so that the probe
+//sequences going through it stay intact
+static int jadwal_migrate_bucket__(struct jadwal *ht, long idx) {
+    struct jadwal *old = ht->old;
+    JADWAL_ASSERT(jadwal_slot_is_occupied(old, idx), "");
+    size_t full_hash = jadwal_bucket_hash__(old, idx);
+    int rv = JADWAL_NOT_FOUND;
+    while (jadwal_at_insert_must_resize(ht) ||
+           (rv = jadwal_insert_unique__(ht, full_hash, jadwal_key_at(old, idx), jadwal_value_at(old, idx))) == JADWAL_NOT_FOUND) {
+        //robin hood / hopscotch limits (or the user inserting faster than we move), grow the new table all at once
+        long nbuckets_before = ht->nbuckets;
+        rv = jadwal_resize__(ht, ht->nbuckets);
+        if (rv != JADWAL_OK || ht->nbuckets == nbuckets_before)
+            return rv == JADWAL_ALLOC_ERR ? rv : JADWAL_FAILED_AT_RESIZE;
+    }
+    if (rv != JADWAL_OK)
+        return rv;
+    jadwal_mark_as_deleted__(old, idx);
+    old->nelements--;
+    old->ndeleted++;
+    return JADWAL_OK;
+}
+
+//moves up to budget buckets of the old table, frees it once it has been walked completely
+static int jadwal_migrate__(struct jadwal *ht, long budget) {
+    struct jadwal *old = ht->old;
+    if (!old)
+        return JADWAL_OK;
+    long end_idx = budget < old->nbuckets - ht->migrate_idx ? ht->migrate_idx + budget : old->nbuckets;
+    for (; ht->migrate_idx < end_idx; ht->migrate_idx++) {
+        if (jadwal_slot_is_occupied(old, ht->migrate_idx)) {
+            int rv = jadwal_migrate_bucket__(ht, ht->migrate_idx);
+            if (rv != JADWAL_OK)
+                return rv;
+        }
+    }
+    if (ht->migrate_idx == old->nbuckets) {
+        JADWAL_ASSERT(old->nelements == 0, "elements left behind");
+        jadwal_deinit(old);
+        ht->memfuncs.free(old, ht->userdata);
+        ht->old = NULL;
+        ht->migrate_idx = 0;
+    }
+    return JADWAL_OK;
+}
+
+//called by every insert and remove while there is an old table: moves a step of buckets, and moves key
+//if it is still in the old table, afterwards only ht has to be searched for it
+static int jadwal_migrate_key__(struct jadwal *ht, jadwal_key_type *key, size_t full_hash) {
+    int rv = jadwal_migrate__(ht, JADWAL_MIGRATE_STEP);
+    if (rv != JADWAL_OK || !ht->old)
+        return rv;
+    long idx;
+    rv = jadwal_find_pos_hashed__(ht->old, key, full_hash, &idx);
+    //robin hood and hopscotch compare keys without looking at the flags, a tombstone can match
+    if (rv == JADWAL_OK && jadwal_slot_is_occupied(ht->old, idx))
+        return jadwal_migrate_bucket__(ht, idx);
+    return (rv == JADWAL_OK || rv == JADWAL_NOT_FOUND) ? JADWAL_OK : rv;
+}
+
+//instead of jadwal_resize__(), the current table becomes the old one and an empty one takes its place
+static int jadwal_start_migration__(struct jadwal *ht) {
+    if (ht->old) {
+        //still moving from the last time (only when the user inserts much faster than the table moves), finish that
+        int rv = jadwal_migrate__(ht, ht->old->nbuckets);
+        if (rv != JADWAL_OK)
+            return rv;
+    }
+    long new_bucket_count = jadwal_resize_nbuckets__(ht, ht->nelements);
+    if (new_bucket_count == 0)
+        return JADWAL_OK;
+    struct jadwal *old = ht->memfuncs.alloc(sizeof *old, ht->userdata);
+    if (!old)
+        return JADWAL_ALLOC_ERR;
+    struct jadwal new_ht;
+    int rv = jadwal_init_copy_settings(&new_ht, new_bucket_count, ht);
+    if (rv != JADWAL_OK) {
+        ht->memfuncs.free(old, ht->userdata);
+        return rv;
+    }
+#ifdef JADWAL_STATS
+    new_ht.stats = ht->stats;
+#endif
+    memcpy(old, ht, sizeof *old);
+    memcpy(ht, &new_ht, sizeof *ht);
+#ifdef JADWAL_ARENA
+    jadwal_arena_move__(ht, old);
+#endif
+    ht->old = old;
+    ht->migrate_idx = 0;
+    return jadwal_migrate__(ht, JADWAL_MIGRATE_STEP);
+}
+#endif // JADWAL_INCREMENTAL
+
+//with JADWAL_INCREMENTAL, moves up to budget buckets of a resize in progress, for calling when idle
+//(jadwal_resizing() tells whether there is anything left), without it there is nothing to do
+static int jadwal_maintenance(struct jadwal *ht, long budget) {
+#ifdef JADWAL_INCREMENTAL
+    return jadwal_migrate__(ht, budget);
+#else
+    (void) ht;
+    (void) budget;
+    return JADWAL_OK;
+#endif
+}
+static bool jadwal_resizing(struct jadwal *ht) {
+#ifdef JADWAL_INCREMENTAL
+    return ht->old != NULL;
+#else
+    (void) ht;
+    return false;
+#endif
+}
+//the number of elements, with JADWAL_INCREMENTAL ht->nelements doesn't count the ones that haven't been moved yet
+static long jadwal_count(struct jadwal *ht) {
+#ifdef JADWAL_INCREMENTAL
+    if (ht->old)
+        return ht->nelements + ht->old->nelements;
+#endif
+    return ht->nelements;
+}
 struct jadwal_iter {
     long started_at_idx;
     long current_idx;
+#ifdef JADWAL_SOA
+    //there is no pair struct in this layout, use jadwal_iter_key() and jadwal_iter_value()
+    jadwal_key_type   *key;
+    jadwal_value_type *value;
+#else
     //public field
     //the two members: pair->key and pair->value can be accessed directly (assuming a valid iterator)
+    //jadwal_iter_key() and jadwal_iter_value() work with any layout
     struct jadwal_pair_type *pair; 
+#endif
+    size_t check_hash; //what the bucket kept of the hash of the element (see jadwal_bucket_check_hash__)
 };
+static jadwal_key_type *jadwal_iter_key(struct jadwal_iter *iter) {
+#ifdef JADWAL_SOA
+    return iter->key;
+#else
+    return iter->pair ? &iter->pair->key : NULL;
+#endif
+}
+static jadwal_value_type *jadwal_iter_value(struct jadwal_iter *iter) {
+#ifdef JADWAL_SOA
+    return iter->value;
+#else
+    return iter->pair ? &iter->pair->value : NULL;
+#endif
+}
+//points the iterator at the bucket idx
+static void jadwal_iter_set_bucket__(struct jadwal *ht, struct jadwal_iter *iter, long idx) {
+#ifdef JADWAL_SOA
+    iter->key   = jadwal_key_at(ht, idx);
+    iter->value = jadwal_value_at(ht, idx);
+#else
+    iter->pair = ht->tab + idx;
+#endif
+    iter->check_hash = jadwal_bucket_check_hash__(ht, idx);
+}
 static struct jadwal_iter jadwal_mk_invalid_iter(void) {
-    struct jadwal_iter iter = {JADWAL_ITER_STOP, JADWAL_ITER_STOP, NULL};
+#ifdef JADWAL_SOA
+    struct jadwal_iter iter = {JADWAL_ITER_STOP, JADWAL_ITER_STOP, NULL, NULL, 0};
+#else
+    struct jadwal_iter iter = {JADWAL_ITER_STOP, JADWAL_ITER_STOP, NULL, 0};
+#endif
     return iter;
 }
-static struct jadwal_iter jadwal_mk_iter(long start_idx, struct jadwal_pair_type *pair) {
-    struct jadwal_iter iter = {start_idx, JADWAL_ITER_FIRST, pair};
+static struct jadwal_iter jadwal_mk_iter(struct jadwal *ht, long start_idx) {
+    struct jadwal_iter iter = jadwal_mk_invalid_iter();
+    iter.started_at_idx = start_idx;
+    iter.current_idx = JADWAL_ITER_FIRST;
+    jadwal_iter_set_bucket__(ht, &iter, start_idx);
     return iter;
 }
 static bool jadwal_iter_check(struct jadwal_iter *iter) {
-    JADWAL_ASSERT((iter->current_idx == JADWAL_ITER_STOP) || (iter->pair != NULL && iter->current_idx >= 0), "invalid iterator state");
+    JADWAL_ASSERT((iter->current_idx == JADWAL_ITER_STOP) || (jadwal_iter_key(iter) != NULL && iter->current_idx >= 0), "invalid iterator state");
     return iter->current_idx != JADWAL_ITER_STOP;
 }
 
 static int jadwal_begin_iterator(struct jadwal *ht, struct jadwal_iter *iter) {
+#ifdef JADWAL_INCREMENTAL
+    //iterating is O(nbuckets) anyway, finish moving so that there is only one table to walk
+    if (ht->old) {
+        int rv = jadwal_maintenance(ht, ht->old->nbuckets);
+        if (rv != JADWAL_OK) {
+            *iter = jadwal_mk_invalid_iter();
+            return rv;
+        }
+    }
+#endif
     long next_idx = jadwal_skip_to_next__(ht, 0, JADWAL_ITER_FIRST, ht->nbuckets - 1);
     if (next_idx < 0) {
         *iter = jadwal_mk_invalid_iter();
@@ -835,7 +2698,7 @@ static int jadwal_begin_iterator(struct jadwal *ht, struct jadwal_iter *iter) {
     }
     iter->started_at_idx = 0;
     iter->current_idx = next_idx;
-    iter->pair = ht->tab + next_idx;
+    jadwal_iter_set_bucket__(ht, iter, next_idx);
     return JADWAL_OK;
 }
 
@@ -852,13 +2715,13 @@ static int jadwal_iter_next(struct jadwal *ht, struct jadwal_iter *iter) {
         return JADWAL_ITER_STOP;
     }
     iter->current_idx = next_idx;
-    iter->pair = ht->tab + next_idx;
+    jadwal_iter_set_bucket__(ht, iter, next_idx);
     return JADWAL_OK;
 }
-static int jadwal_find(struct jadwal *ht, jadwal_key_type *key, struct jadwal_iter *out) {
+//jadwal_find() without hashing the key and (with JADWAL_INCREMENTAL) only in ht, not in the old table
+static int jadwal_find_hashed__(struct jadwal *ht, jadwal_key_type *key, size_t full_hash, struct jadwal_iter *out) {
     long found_idx;
-    size_t full_hash_unused;
-    int rv = jadwal_find_pos__(ht, key, &found_idx, &full_hash_unused);
+    int rv = jadwal_find_pos_hashed__(ht, key, full_hash, &found_idx);
     if (rv == JADWAL_NOT_FOUND) {
         *out = jadwal_mk_invalid_iter();
         return rv;
@@ -869,16 +2732,114 @@ static int jadwal_find(struct jadwal *ht, jadwal_key_type *key, struct jadwal_it
         return rv;
     }
     JADWAL_ASSERT(found_idx >= 0 && found_idx < ht->nbuckets, "find pos returned invalid index");
-    struct jadwal_pair_type *pair = ht->tab + found_idx;
-    *out = jadwal_mk_iter(found_idx, pair);
+    *out = jadwal_mk_iter(ht, found_idx);
     return JADWAL_OK;
 }
+#ifdef JADWAL_INCREMENTAL
+//a lookup that missed ht looks in the old table, without moving anything (a key is in one of the two)
+static int jadwal_find_old__(struct jadwal *ht, jadwal_key_type *key, size_t full_hash, int rv, struct jadwal_iter *out) {
+    if (rv != JADWAL_NOT_FOUND || !ht->old)
+        return rv;
+    long idx;
+    rv = jadwal_find_pos_hashed__(ht->old, key, full_hash, &idx);
+    //robin hood and hopscotch compare keys without looking at the flags, a tombstone can match
+    if (rv == JADWAL_OK && jadwal_slot_is_occupied(ht->old, idx)) {
+        *out = jadwal_mk_iter(ht->old, idx);
+        return JADWAL_OK;
+    }
+    return (rv == JADWAL_OK || rv == JADWAL_NOT_FOUND) ? JADWAL_NOT_FOUND : rv;
+}
+#endif
+//jadwal_find() with the hash of the key already computed (it must be what jadwal_hash() returns for it)
+static int jadwal_find_hashed(struct jadwal *ht, jadwal_key_type *key, size_t full_hash, struct jadwal_iter *out) {
+    JADWAL_ASSERT(full_hash == jadwal_key_hash__(ht, key), "the hash passed isn't the hash of the key");
+    int rv = jadwal_find_hashed__(ht, key, full_hash, out);
+#ifdef JADWAL_INCREMENTAL
+    rv = jadwal_find_old__(ht, key, full_hash, rv, out);
+#endif
+    return rv;
+}
+static int jadwal_find(struct jadwal *ht, jadwal_key_type *key, struct jadwal_iter *out) {
+    return jadwal_find_hashed(ht, key, jadwal_key_hash__(ht, key), out);
+}
+//the hash the _hashed functions take, jadwal_hash() of the key (with JADWAL_DATA_ARG called with ht->userdata)
+static size_t jadwal_key_hash(struct jadwal *ht, jadwal_key_type *key) {
+    return jadwal_key_hash__(ht, key);
+}
+//removes the element iter points at (from jadwal_find() or iterating) without looking for it again, afterwards iter is
+//invalid, no call may have changed ht since iter was filled in (an insert, remove, jadwal_maintenance(), or with
+//JADWAL_INCREMENTAL jadwal_begin_iterator()), when one did and the bucket no longer holds the element (it was removed or
+//moved, another one was shifted or inserted there, the table was resized) this returns JADWAL_NOT_FOUND and removes
+//nothing, the bucket is checked against the partial hash the iterator kept (the full hash with JADWAL_STORE_HASH), so
+//only another element with the same one there can't be told apart
+//(with JADWAL_STORE_HASH off, hopscotch hashes the key again to find its home bucket)
+static int jadwal_remove_iter(struct jadwal *ht, struct jadwal_iter *iter) {
+    //jadwal_find() leaves current_idx at JADWAL_ITER_FIRST, the bucket is started_at_idx then
+    long idx = iter->current_idx == JADWAL_ITER_FIRST ? iter->started_at_idx : iter->current_idx;
+#ifdef JADWAL_INCREMENTAL
+    //a lookup can point into the old table, the element is dropped from there
+    struct jadwal *old = ht->old;
+    if (old && iter->current_idx == JADWAL_ITER_FIRST && idx >= 0 && idx < old->nbuckets &&
+        jadwal_slot_is_occupied(old, idx) && jadwal_iter_key(iter) == jadwal_key_at(old, idx) &&
+        jadwal_bucket_check_hash__(old, idx) == iter->check_hash) {
+        jadwal_mark_as_deleted__(old, idx);
+        old->nelements--;
+        old->ndeleted++;
+        *iter = jadwal_mk_invalid_iter();
+        return JADWAL_OK;
+    }
+#endif
+    if (idx < 0 || idx >= ht->nbuckets || !jadwal_slot_is_occupied(ht, idx) ||
+        jadwal_iter_key(iter) != jadwal_key_at(ht, idx) || jadwal_bucket_check_hash__(ht, idx) != iter->check_hash)
+        return JADWAL_NOT_FOUND;
+#ifdef JADWAL_HOPSCOTCH
+    size_t full_hash = jadwal_bucket_hash__(ht, idx);
+#else
+    size_t full_hash = 0;
+#endif
+    *iter = jadwal_mk_invalid_iter();
+    return jadwal_remove_at__(ht, idx, full_hash);
+}
+
+//looks up keys[0 .. n), iters_out[i] and status_out[i] (either can be NULL) get what jadwal_find(ht, &keys[i], ...)
+//would have given, the keys are taken JADWAL_FIND_BATCH at a time: all of them are hashed and the first bucket of each
+//probe is prefetched, then (with JADWAL_PREFETCH_KEY) the stored key in that bucket if it looks like a match, and only
+//then are the probes run, so the cache misses of the batch overlap instead of each lookup waiting on its own
+//returns JADWAL_OK if every key was found, JADWAL_NOT_FOUND if some weren't, or the first other error
+static int jadwal_find_batch(struct jadwal *ht, jadwal_key_type *keys, long n, struct jadwal_iter *iters_out, int *status_out) {
+    size_t batch_hash[JADWAL_FIND_BATCH];
+    int result = JADWAL_OK;
+    for (long begin = 0; begin < n; begin += JADWAL_FIND_BATCH) {
+        int batch_n = n - begin < JADWAL_FIND_BATCH ? (int) (n - begin) : JADWAL_FIND_BATCH;
+        for (int i = 0; i < batch_n; i++)
+            batch_hash[i] = jadwal_key_hash__(ht, &keys[begin + i]);
+        for (int i = 0; i < batch_n; i++)
+            jadwal_prefetch_bucket_read__(ht, jadwal_integer_mod_buckets(ht, batch_hash[i]));
+#ifdef JADWAL_PREFETCH_KEY
+        for (int i = 0; i < batch_n; i++)
+            jadwal_prefetch_home_key__(ht, batch_hash[i]);
+#endif
+        for (int i = 0; i < batch_n; i++) {
+            struct jadwal_iter iter;
+            int rv = jadwal_find_hashed__(ht, &keys[begin + i], batch_hash[i], &iter);
+#ifdef JADWAL_INCREMENTAL
+            rv = jadwal_find_old__(ht, &keys[begin + i], batch_hash[i], rv, &iter);
+#endif
+            if (iters_out)
+                iters_out[begin + i] = iter;
+            if (status_out)
+                status_out[begin + i] = rv;
+            if (rv != JADWAL_OK && (result == JADWAL_OK || (result == JADWAL_NOT_FOUND && rv != JADWAL_NOT_FOUND)))
+                result = rv;
+        }
+    }
+    return result;
+}
 static int jadwal_find_or_insert(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, struct jadwal_iter *out) {
     long found_idx;
     int rv = jadwal_insert__(ht, key, value, &found_idx, true /*do replace*/);
     if (rv == JADWAL_OK) {
-        struct jadwal_pair_type *pair = ht->tab + found_idx;
-        *out = jadwal_mk_iter(found_idx, pair);
+        *out = jadwal_mk_iter(ht, found_idx);
     }
     else {
         *out = jadwal_mk_invalid_iter();
@@ -886,3 +2847,316 @@ static int jadwal_find_or_insert(struct jadwal *ht, jadwal_key_type *key, jadwal
     return rv;
 }
 
+//insert if absent, with a single lookup: on a miss the key is inserted with a zeroed value and ctor (if not NULL) is
+//called on it, on a hit the value is left alone, either way *value_out points at the value in the table until the
+//next insert, remove, jadwal_maintenance() or (with JADWAL_INCREMENTAL) jadwal_begin_iterator(), lookups don't move
+//it, returns JADWAL_OK when the key was inserted and JADWAL_DUPLICATE_KEY when it was there
+//ctor must not use the table
+static int jadwal_try_emplace(struct jadwal *ht, jadwal_key_type *key, jadwal_value_ctor_fptr ctor, void *arg,
+                              jadwal_value_type **value_out) {
+    long found_idx;
+    int rv = jadwal_insert_hashed__(ht, key, NULL, jadwal_key_hash__(ht, key), &found_idx, false /*dont replace*/);
+    if (rv != JADWAL_OK && rv != JADWAL_DUPLICATE_KEY) {
+        *value_out = NULL;
+        return rv;
+    }
+    *value_out = jadwal_value_at(ht, found_idx);
+    if (rv == JADWAL_OK && ctor)
+        ctor(jadwal_key_at(ht, found_idx), *value_out, arg);
+    return rv;
+}
+
+#if defined(JADWAL_ARENA) && defined(JADWAL_STR_KEYS)
+//makes a key out of a copy of the len bytes at ptr kept in the arena of ht (with JADWAL_STR_INLINE, strings that fit in
+//the key aren't copied anywhere else), returns JADWAL_ALLOC_ERR when the arena can't grow
+static int jadwal_str_copy(struct jadwal *ht, const char *ptr, size_t len, jadwal_key_type *key_out) {
+#ifdef JADWAL_STR_INLINE
+    if (len <= JADWAL_STR_INLINE_MAX) {
+        *key_out = jadwal_str_make(ptr, len);
+        return JADWAL_OK;
+    }
+#endif
+    char *copy = jadwal_arena_alloc(ht, len);
+    if (!copy)
+        return JADWAL_ALLOC_ERR;
+    if (len > 0)
+        memcpy(copy, ptr, len);
+    *key_out = jadwal_str_make(copy, len);
+    return JADWAL_OK;
+}
+//gives the bytes of a key from jadwal_str_copy() back to the arena
+static void jadwal_str_release(struct jadwal *ht, jadwal_key_type *key) {
+#ifdef JADWAL_STR_INLINE
+    if (key->len <= JADWAL_STR_INLINE_MAX)
+        return;
+#endif
+    jadwal_arena_free(ht, (void *) jadwal_str_data(key), key->len);
+}
+
+//like jadwal_insert(), but the table keeps a copy of the string in its arena (the caller's can be reused right after),
+//such keys are removed with jadwal_remove_copy(), or freed all at once by jadwal_deinit()
+static int jadwal_insert_copy(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value) {
+    size_t full_hash = jadwal_key_hash__(ht, key);
+    long found_idx;
+    int rv = jadwal_insert_hashed__(ht, key, value, full_hash, &found_idx, false /*dont replace*/);
+    if (rv != JADWAL_OK)
+        return rv;
+    //only copied once it's known to be new, the copy has the same bytes so it stays in the right bucket
+    rv = jadwal_str_copy(ht, jadwal_str_data(key), key->len, jadwal_key_at(ht, found_idx));
+    if (rv != JADWAL_OK)
+        jadwal_remove_at__(ht, found_idx, full_hash);
+    return rv;
+}
+//removes a key inserted with jadwal_insert_copy() and gives its copy back to the arena
+static int jadwal_remove_copy(struct jadwal *ht, jadwal_key_type *key) {
+    struct jadwal_iter iter;
+    int rv = jadwal_find(ht, key, &iter);
+    if (rv != JADWAL_OK)
+        return rv;
+    jadwal_key_type stored = *jadwal_iter_key(&iter); //removing can move other keys into the bucket
+    rv = jadwal_remove_iter(ht, &iter);
+    if (rv == JADWAL_OK)
+        jadwal_str_release(ht, &stored);
+    return rv;
+}
+#endif
+
+//grows the table now if needed, so that the next n inserts don't have to (with JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH
+//they still can, when a probe distance / neighbourhood overflows)
+static int jadwal_reserve(struct jadwal *ht, long n) {
+    long needed = jadwal_count(ht) + n;
+    if (n <= 0 || needed < ht->grow_at_gt_n)
+        return JADWAL_OK;
+    return jadwal_resize__(ht, needed);
+}
+
+struct jadwal_batch_item__ {
+    long home; //first bucket of the probe
+    long item; //index into the batch
+    size_t full_hash;
+};
+
+//inserts a part of a batch in the order of the first buckets, items has room for 2 * n, range_begin for 2 * n + 1
+static int jadwal_insert_sorted__(struct jadwal *ht, jadwal_key_type *keys, jadwal_value_type *values, long n,
+                                  bool or_replace, int *status_out, struct jadwal_batch_item__ *items, long *range_begin)
+{
+    uint64_t nranges = 1;
+    while (nranges < (uint64_t) n && nranges < (uint64_t) ht->nbuckets)
+        nranges *= 2;
+    memset(range_begin, 0, (nranges + 1) * sizeof(long));
+    struct jadwal_batch_item__ *sorted = items + n;
+    for (long i = 0; i < n; i++) {
+        items[i].item = i;
+        items[i].full_hash = jadwal_key_hash__(ht, &keys[i]);
+        items[i].home = jadwal_integer_mod_buckets(ht, items[i].full_hash);
+        range_begin[((uint64_t) items[i].home * nranges) / ht->nbuckets + 1]++;
+    }
+    for (uint64_t r = 1; r <= nranges; r++)
+        range_begin[r] += range_begin[r - 1];
+    for (long i = 0; i < n; i++)
+        sorted[range_begin[((uint64_t) items[i].home * nranges) / ht->nbuckets]++] = items[i];
+
+    int rv = JADWAL_OK;
+    long i = 0;
+    for (; i < n; i++) {
+        if (i + JADWAL_REHASH_BATCH < n)
+            jadwal_prefetch_bucket__(ht, sorted[i + JADWAL_REHASH_BATCH].home);
+        long item = sorted[i].item;
+        long found_idx;
+        rv = jadwal_insert_hashed__(ht, &keys[item], &values[item], sorted[i].full_hash, &found_idx, false);
+        if (rv == JADWAL_DUPLICATE_KEY && or_replace)
+            memcpy(jadwal_value_at(ht, found_idx), &values[item], sizeof values[item]);
+        if (status_out)
+            status_out[item] = rv;
+        if (rv != JADWAL_OK && rv != JADWAL_DUPLICATE_KEY)
+            break;
+    }
+    if (i == n)
+        return JADWAL_OK;
+    for (long j = i + 1; status_out && j < n; j++)
+        status_out[sorted[j].item] = rv;
+    return rv;
+}
+
+//inserts keys[i] -> values[i] for i in [0, n), status_out[i] (can be NULL) is JADWAL_OK if keys[i] was new, or
+//JADWAL_DUPLICATE_KEY if it was already there (including earlier in the batch), its value is replaced then when
+//or_replace is true, so the table ends up as it would with the inserts made one after the other in batch order
+//room for the whole batch is made up front, then JADWAL_INSERT_BATCH keys at a time are hashed and inserted in the order
+//of their first bucket, so consecutive writes land near each other instead of all over the table, the buckets
+//JADWAL_REHASH_BATCH inserts ahead are prefetched
+//the order comes from a counting sort on the first bucket scaled down to about JADWAL_INSERT_BATCH ranges, it's stable
+//so the inserts of the same key (same first bucket) stay in batch order
+//on an error the batch stops and it's returned, the items that weren't inserted get it as their status
+static int jadwal_insert_batch(struct jadwal *ht, jadwal_key_type *keys, jadwal_value_type *values, long n,
+                               bool or_replace, int *status_out)
+{
+    if (n <= 0)
+        return JADWAL_OK;
+    int rv = jadwal_reserve(ht, n);
+    if (rv != JADWAL_OK)
+        return rv;
+    long chunk = n < JADWAL_INSERT_BATCH ? n : JADWAL_INSERT_BATCH;
+    size_t alloc_size = 2 * chunk * sizeof(struct jadwal_batch_item__) + (2 * chunk + 1) * sizeof(long);
+    struct jadwal_batch_item__ *items = ht->memfuncs.alloc(alloc_size, ht->userdata);
+    if (!items)
+        return JADWAL_ALLOC_ERR;
+    long *range_begin = (long *) (items + 2 * chunk);
+    long i = 0;
+    for (; i < n && rv == JADWAL_OK; i += chunk) {
+        long m = n - i < chunk ? n - i : chunk;
+        rv = jadwal_insert_sorted__(ht, keys + i, values + i, m, or_replace, status_out ? status_out + i : NULL, items,
+                                    range_begin);
+    }
+    for (; status_out && i < n; i++)
+        status_out[i] = rv;
+    ht->memfuncs.free(items, ht->userdata);
+    return rv;
+}
+
+#ifdef JADWAL_PARALLEL_RESIZE
+struct jadwal_build__ {
+    struct jadwal *ht;
+    jadwal_key_type *keys;
+    jadwal_value_type *values;
+    struct jadwal_batch_item__ *items; //grouped by task, in batch order within a task
+    long *task_begin; //ntasks + 1 indices into items
+    long *nplaced;    //per task
+    long *ndeferred;  //per task, moved to the front of the task's items
+    long ntasks;
+};
+//places a key whose first bucket is in [begin_idx, end_idx) while other tasks do the same in their own ranges, only the
+//buckets of that range are read or written, JADWAL_NOT_FOUND means the probe left it (the key is placed afterwards)
+//a fresh table has no tombstones, so the first empty bucket of the probe is where the key goes and nothing past it can
+//hold the key, group probing walks the buckets in order too, here a byte at a time so no group is loaded across end_idx
+static int jadwal_build_place__(struct jadwal *ht, long begin_idx, long end_idx, jadwal_key_type *key,
+                                jadwal_value_type *value, size_t full_hash) {
+    long idx = jadwal_integer_mod_buckets(ht, full_hash);
+#ifdef JADWAL_GROUP_PROBE
+    (void) begin_idx;
+    unsigned char tag = jadwal_hash_to_ctrl_tag(full_hash);
+    for (; idx < end_idx && ht->ctrl[idx] != JADWAL_CTRL_EMPTY; idx++) {
+        if (ht->ctrl[idx] == tag && jadwal_key_cmp__(ht, key, jadwal_key_at(ht, idx)) == 0)
+            return JADWAL_DUPLICATE_KEY;
+    }
+    if (idx == end_idx)
+        return JADWAL_NOT_FOUND;
+    ht->ctrl[idx] = tag; //the mirrored bytes are written afterwards
+#else
+    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
+    long step = jadwal_probe_step(ht, full_hash);
+    for (long i = 0; !jadwal_slot_is_empty(ht, idx); i++) {
+        if (jadwal_cmp(ht, key, partial_hash, idx) == 0)
+            return JADWAL_DUPLICATE_KEY;
+        idx = jadwal_probe_next(ht, idx, i, step);
+        if (idx < begin_idx || idx >= end_idx)
+            return JADWAL_NOT_FOUND;
+    }
+    *jadwal_pair_data_at(ht, idx) = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY, partial_hash);
+#endif
+#ifdef JADWAL_STORE_HASH
+    *jadwal_hash_at(ht, idx) = full_hash;
+#endif
+    memcpy(jadwal_key_at(ht, idx), key, sizeof(jadwal_key_type));
+    memcpy(jadwal_value_at(ht, idx), value, sizeof(jadwal_value_type));
+    return JADWAL_OK;
+}
+static void jadwal_build_task__(void *arg, long task_idx) {
+    struct jadwal_build__ *build = (struct jadwal_build__ *) arg;
+    struct jadwal *ht = build->ht;
+    long begin_idx = ht->nbuckets * task_idx / build->ntasks;
+    long end_idx = ht->nbuckets * (task_idx + 1) / build->ntasks;
+    struct jadwal_batch_item__ *items = build->items + build->task_begin[task_idx];
+    long n = build->task_begin[task_idx + 1] - build->task_begin[task_idx];
+    long nplaced = 0;
+    long ndeferred = 0;
+    for (long i = 0; i < n; i++) {
+        if (i + JADWAL_REHASH_BATCH < n)
+            jadwal_prefetch_bucket__(ht, items[i + JADWAL_REHASH_BATCH].home);
+        long item = items[i].item;
+        int rv = jadwal_build_place__(ht, begin_idx, end_idx, &build->keys[item], &build->values[item], items[i].full_hash);
+        nplaced += rv == JADWAL_OK;
+        if (rv == JADWAL_NOT_FOUND)
+            items[ndeferred++] = items[i];
+    }
+    build->nplaced[task_idx] = nplaced;
+    build->ndeferred[task_idx] = ndeferred;
+}
+#endif
+
+//fills an empty table with keys[i] -> values[i] for i in [0, n), sized once for n elements up front, a key that is
+//there more than once keeps its first value (as if they were inserted one after the other)
+//with JADWAL_PARALLEL_RESIZE, a task runner and at least JADWAL_PARALLEL_MIN keys, the buckets are split into one range
+//per task and the keys are partitioned by the range their first bucket is in, each task fills only its own range, the
+//few keys whose probe runs past its end are inserted on the calling thread afterwards
+//otherwise, or if the table isn't empty, this is jadwal_insert_batch()
+//on an error the table holds a part of the keys
+static int jadwal_build_from(struct jadwal *ht, jadwal_key_type *keys, jadwal_value_type *values, long n) {
+#ifdef JADWAL_PARALLEL_RESIZE
+    bool is_fresh = ht->nelements == 0 && ht->ndeleted == 0;
+#ifdef JADWAL_INCREMENTAL
+    is_fresh = is_fresh && !ht->old;
+#endif
+    if (!is_fresh || !ht->run_tasks || ht->ntasks < 2 || n < JADWAL_PARALLEL_MIN)
+        return jadwal_insert_batch(ht, keys, values, n, false, NULL);
+    int rv = jadwal_reserve(ht, n);
+    if (rv != JADWAL_OK)
+        return rv;
+    long ntasks = ht->ntasks;
+    size_t alloc_size = 2 * n * sizeof(struct jadwal_batch_item__) + (4 * ntasks + 1) * sizeof(long);
+    struct jadwal_batch_item__ *items = ht->memfuncs.alloc(alloc_size, ht->userdata);
+    if (!items)
+        return JADWAL_ALLOC_ERR;
+    struct jadwal_build__ build;
+    build.ht = ht;
+    build.keys = keys;
+    build.values = values;
+    build.items = items + n;
+    build.task_begin = (long *) (items + 2 * n);
+    build.nplaced = build.task_begin + ntasks + 1;
+    build.ndeferred = build.nplaced + ntasks;
+    build.ntasks = ntasks;
+    long *task_next = build.ndeferred + ntasks;
+
+    //a stable counting sort by task, the range of a bucket is [nbuckets * t / ntasks, nbuckets * (t + 1) / ntasks)
+    memset(build.task_begin, 0, (ntasks + 1) * sizeof(long));
+    for (long i = 0; i < n; i++) {
+        items[i].item = i;
+        items[i].full_hash = jadwal_key_hash__(ht, &keys[i]);
+        items[i].home = jadwal_integer_mod_buckets(ht, items[i].full_hash);
+        build.task_begin[((uint64_t) items[i].home * ntasks) / ht->nbuckets + 1]++;
+    }
+    for (long t = 1; t <= ntasks; t++)
+        build.task_begin[t] += build.task_begin[t - 1];
+    memcpy(task_next, build.task_begin, ntasks * sizeof(long));
+    for (long i = 0; i < n; i++)
+        build.items[task_next[((uint64_t) items[i].home * ntasks) / ht->nbuckets]++] = items[i];
+
+    ht->run_tasks(jadwal_build_task__, &build, ntasks, ht->userdata);
+#ifdef JADWAL_GROUP_PROBE
+    for (long i = 0; i < JADWAL_GROUP_WIDTH; i++)
+        ht->ctrl[ht->nbuckets + i] = ht->ctrl[i % ht->nbuckets];
+#endif
+    for (long t = 0; t < ntasks; t++)
+        ht->nelements += build.nplaced[t];
+    //a key placed by a task is found by the probe of its later copies before they leave the range, a key that was
+    //deferred has all its copies deferred, and each task keeps them in batch order
+    for (long t = 0; t < ntasks && rv == JADWAL_OK; t++) {
+        struct jadwal_batch_item__ *deferred = build.items + build.task_begin[t];
+        for (long i = 0; i < build.ndeferred[t]; i++) {
+            long item = deferred[i].item;
+            long found_idx;
+            rv = jadwal_insert_hashed__(ht, &keys[item], &values[item], deferred[i].full_hash, &found_idx, false);
+            if (rv == JADWAL_DUPLICATE_KEY)
+                rv = JADWAL_OK;
+            if (rv != JADWAL_OK)
+                break;
+        }
+    }
+    ht->memfuncs.free(items, ht->userdata);
+    JADWAL_ASSERT(rv != JADWAL_OK || jadwal_dbg_sanity_heavy(ht), "");
+    return rv;
+#else
+    return jadwal_insert_batch(ht, keys, values, n, false, NULL);
+#endif
+}
+
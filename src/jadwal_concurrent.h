@@ -0,0 +1,606 @@
+/*
+Copyright 2019 Turki Alsaleem
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+a wrapper around struct jadwal for tables that are read from many threads and written from a few, link with -pthread
+
+the same things have to be defined before including this as for jadwal.h, jadwal.h is included from here with
+JADWAL_MANUAL_RESIZE defined (so it must not have been included before)
+
+readers never take a lock: jadwal_concurrent_find() copies the value out under a sequence counter and looks again if a
+writer changed the table in the meantime, writers take a mutex, a reader that comes in while a writer is in the middle
+of a single insert / remove yields until it's done (the only other time is the fallback below)
+when the table has to grow, or its tombstones have to be purged, a background thread builds the new one (for a purge
+one sized for the elements that are left): it copies the live buckets a chunk at a time
+(reading a chunk again if a write happened while it was being read), meanwhile writers keep changing the live table
+and log what they did, then the builder takes the writer lock, replays the log and publishes the new table with an
+atomic pointer store, readers that are still in the old table finish there, and it is freed once no reader is inside
+a writer only waits for the builder when the live table gets half way from the grow threshold to full
+only when the live table is completely full and no build can be started (no memory) are its tombstones purged in place,
+readers wait for that whole rehash then
+
+jadwal_concurrent_find() counts the readers inside with a shared counter, that is one cache line every reader writes to,
+threads that do a lot of lookups should get a struct jadwal_concurrent_reader each instead (epoch based reclamation):
+a reader announces the epoch it saw in its own slot (padded to a cache line) and clears it when done, a retired table
+is tagged with the epoch it was retired in and freed once every registered reader is out or in a later epoch, so a
+lookup through jadwal_concurrent_reader_find() writes to nothing shared
+
+jadwal_key_eq_cmp() can be handed a key that is in the middle of being written, what it returns is thrown away then,
+but it must not follow pointers in the keys to get there (a half written pointer points anywhere), so keys are plain
+data that is compared as it is, JADWAL_STR_KEYS isn't available (its keys point to the bytes, or with JADWAL_STR_INLINE
+hold them or a pointer depending on the length), values are only copied and can be any plain data
+
+the api: jadwal_concurrent_init / init_with_udata / deinit / insert / remove / find / count / wait (for a build in
+progress to be published), jadwal_concurrent_reader_init / reader_deinit / reader_find, values are copied in and out,
+there are no iterators
+not available with JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH (their inserts move other elements, which the chunked copy
+can't see), JADWAL_INCREMENTAL (inserts and removes move elements between two tables) or JADWAL_STATS (lookups
+would write to the table)
+
+optional defines (compile time):
+    JADWAL_CONCURRENT_CHUNK   how many buckets the builder copies between two checks of the sequence counter (256)
+*/
+
+#ifdef JADWAL_CONCURRENT_H
+#error "the header can only be safely included once"
+#endif // #ifdef JADWAL_CONCURRENT_H
+#define JADWAL_CONCURRENT_H
+
+#ifdef JADWAL_H
+#error "include jadwal_concurrent.h instead of jadwal.h, it needs jadwal.h with JADWAL_MANUAL_RESIZE"
+#endif
+#ifdef JADWAL_STATS
+#error "JADWAL_STATS can't be combined with jadwal_concurrent.h"
+#endif
+#ifdef JADWAL_STR_KEYS
+#error "JADWAL_STR_KEYS can't be combined with jadwal_concurrent.h, readers compare keys a writer may be changing"
+#endif
+#ifndef __GNUC__
+#error "jadwal_concurrent.h uses the __atomic builtins of gcc / clang"
+#endif
+
+#define JADWAL_MANUAL_RESIZE
+#include "jadwal.h"
+#include <pthread.h>
+#include <sched.h> //sched_yield
+
+#ifndef JADWAL_CONCURRENT_CHUNK
+    #define JADWAL_CONCURRENT_CHUNK 256
+#endif
+#if JADWAL_CONCURRENT_CHUNK < 1
+    #error "JADWAL_CONCURRENT_CHUNK must be at least 1"
+#endif
+
+//under thread sanitizer the reads between read_begin and read_end are hidden from it, they race with the writers by
+//design and what they saw is thrown away when read_end fails, everything outside of the read sections is still checked
+#if defined(__SANITIZE_THREAD__)
+    #define JADWAL_CONCURRENT_TSAN__
+#elif defined(__has_feature)
+    #if __has_feature(thread_sanitizer)
+        #define JADWAL_CONCURRENT_TSAN__
+    #endif
+#endif
+#ifdef JADWAL_CONCURRENT_TSAN__
+void AnnotateIgnoreReadsBegin(const char *file, int line);
+void AnnotateIgnoreReadsEnd(const char *file, int line);
+    #define jadwal_concurrent_ignore_reads_begin__() AnnotateIgnoreReadsBegin(__FILE__, __LINE__)
+    #define jadwal_concurrent_ignore_reads_end__() AnnotateIgnoreReadsEnd(__FILE__, __LINE__)
+#else
+    #define jadwal_concurrent_ignore_reads_begin__() ((void)0)
+    #define jadwal_concurrent_ignore_reads_end__() ((void)0)
+#endif
+
+struct jadwal_concurrent_table {
+    struct jadwal ht;
+    unsigned long seq; //odd while a writer is changing ht
+    struct jadwal_concurrent_table *retired_next;
+    unsigned long retired_epoch; //the value of epoch when it was replaced
+};
+
+//one per reading thread, registered with jadwal_concurrent_reader_init()
+struct jadwal_concurrent_reader {
+    unsigned long epoch; //0 outside a lookup, only written by the thread that owns the reader
+    char pad[64]; //nothing else written to shares epoch's cache line
+    struct jadwal_concurrent *c;
+    struct jadwal_concurrent_reader *next; //protected by write_lock
+};
+
+enum jadwal_concurrent_op {
+    JADWAL_CONCURRENT_OP_INSERT,
+    JADWAL_CONCURRENT_OP_REMOVE,
+};
+struct jadwal_concurrent_log_entry {
+    int op;
+    jadwal_key_type key;
+    jadwal_value_type value; //only for inserts
+};
+
+struct jadwal_concurrent {
+    struct jadwal_concurrent_table *current; //the live table, only replaced with an atomic store
+    long nreaders; //jadwal_concurrent_find() calls inside some table, retired tables are freed when this is seen at 0
+    unsigned long epoch; //starts at 1, bumped after every publish, only changed with write_lock held
+
+    //everything below is protected by write_lock
+    pthread_mutex_t write_lock;
+    pthread_cond_t build_done;
+    bool building;
+    bool builder_joinable;
+    pthread_t builder;
+    int build_rv;
+    struct jadwal_concurrent_table *next; //being built
+    struct jadwal_concurrent_log_entry *log; //the writes made to current while next is being built
+    long log_len;
+    long log_cap;
+    struct jadwal_concurrent_table *retired;
+    struct jadwal_concurrent_reader *readers;
+    long nbuilds; //how many tables were published
+    long npurges_in_place; //how many times the fallback purge held up the readers
+};
+
+//the buckets the builder copies from one chunk, before they're known to be consistent
+struct jadwal_concurrent_stage__ {
+    jadwal_key_type keys[JADWAL_CONCURRENT_CHUNK];
+    jadwal_value_type values[JADWAL_CONCURRENT_CHUNK];
+};
+
+//sequence counter, a reader looks at the table between read_begin and read_end and throws away what it saw if
+//read_end fails, the table data itself is read and written with plain accesses
+static unsigned long jadwal_concurrent_read_begin__(struct jadwal_concurrent_table *t) {
+    unsigned long seq;
+    while ((seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE)) & 1)
+        sched_yield(); //a writer is in the middle of an insert / remove (or of the fallback purge)
+    jadwal_concurrent_ignore_reads_begin__();
+    return seq;
+}
+static bool jadwal_concurrent_read_end__(struct jadwal_concurrent_table *t, unsigned long seq) {
+    jadwal_concurrent_ignore_reads_end__();
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&t->seq, __ATOMIC_RELAXED) == seq;
+}
+static void jadwal_concurrent_write_begin__(struct jadwal_concurrent_table *t) {
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+static void jadwal_concurrent_write_end__(struct jadwal_concurrent_table *t) {
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+static struct jadwal_concurrent_table *jadwal_concurrent_table_alloc__(const struct jadwal *settings_from, long nbuckets) {
+    struct jadwal_concurrent_table *t = settings_from->memfuncs.alloc(sizeof *t, settings_from->userdata);
+    if (!t)
+        return NULL;
+    if (jadwal_init_copy_settings(&t->ht, nbuckets, settings_from) != JADWAL_OK) {
+        settings_from->memfuncs.free(t, settings_from->userdata);
+        return NULL;
+    }
+    t->seq = 0;
+    t->retired_next = NULL;
+    t->retired_epoch = 0;
+    return t;
+}
+static void jadwal_concurrent_table_free__(struct jadwal_concurrent_table *t) {
+    struct jadwal_alloc_funcs memfuncs = t->ht.memfuncs;
+    void *userdata = t->ht.userdata;
+    jadwal_deinit(&t->ht);
+    memfuncs.free(t, userdata);
+}
+
+//frees the retired tables no reader can be inside anymore, a reader that comes in later can only see current
+//a registered reader in epoch e loaded current after epoch became e, so it's only inside tables retired in e or later
+static void jadwal_concurrent_reclaim__(struct jadwal_concurrent *c) {
+    if (!c->retired || __atomic_load_n(&c->nreaders, __ATOMIC_SEQ_CST) != 0)
+        return;
+    unsigned long min_epoch = __atomic_load_n(&c->epoch, __ATOMIC_RELAXED);
+    for (struct jadwal_concurrent_reader *r = c->readers; r; r = r->next) {
+        unsigned long epoch = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < min_epoch)
+            min_epoch = epoch;
+    }
+    struct jadwal_concurrent_table **link = &c->retired;
+    while (*link) {
+        struct jadwal_concurrent_table *t = *link;
+        if (t->retired_epoch < min_epoch) {
+            *link = t->retired_next;
+            jadwal_concurrent_table_free__(t);
+        }
+        else {
+            link = &t->retired_next;
+        }
+    }
+}
+
+//inserts into a table that no one else can see yet, growing it when needed
+static int jadwal_concurrent_put__(struct jadwal *ht, jadwal_key_type *key, jadwal_value_type *value, bool or_replace) {
+    if (jadwal_at_insert_must_resize(ht) || jadwal_n_empty_buckets(ht) <= 1) {
+        if (ht->nelements >= ht->grow_at_gt_n) {
+            int rv = jadwal_resize__(ht, ht->nelements);
+            if (rv != JADWAL_OK)
+                return rv;
+        }
+        else {
+            jadwal_purge_tombstones__(ht);
+        }
+    }
+    long idx;
+    return jadwal_insert__(ht, key, value, &idx, or_replace);
+}
+
+//copies the occupied buckets in [begin, end) of src to stage, returns how many
+static long jadwal_concurrent_copy_chunk__(struct jadwal_concurrent_table *src, long begin, long end, struct jadwal_concurrent_stage__ *stage) {
+    long n;
+    unsigned long seq;
+    do {
+        seq = jadwal_concurrent_read_begin__(src);
+        n = 0;
+        for (long idx = begin; idx < end; idx++) {
+            if (!jadwal_slot_is_occupied(&src->ht, idx))
+                continue;
+            memcpy(&stage->keys[n], jadwal_key_at(&src->ht, idx), sizeof(jadwal_key_type));
+            memcpy(&stage->values[n], jadwal_value_at(&src->ht, idx), sizeof(jadwal_value_type));
+            n++;
+        }
+    } while (!jadwal_concurrent_read_end__(src, seq));
+    return n;
+}
+
+//fills c->next from c->current while writers keep going, called without the lock
+//current and next only change when a build is finished, so they can be read here without it
+//an element is either seen in its bucket or was written after its chunk was copied, and then it's in the log (inserts
+//never move other elements in the modes this is available in, and tombstones aren't purged during a build)
+static int jadwal_concurrent_copy__(struct jadwal_concurrent *c) {
+    struct jadwal_concurrent_table *src = c->current;
+    struct jadwal *dst = &c->next->ht;
+    struct jadwal_concurrent_stage__ *stage = dst->memfuncs.alloc(sizeof *stage, dst->userdata);
+    if (!stage)
+        return JADWAL_ALLOC_ERR;
+    int rv = JADWAL_OK;
+    long nbuckets = src->ht.nbuckets;
+    for (long begin = 0; begin < nbuckets && rv == JADWAL_OK; begin += JADWAL_CONCURRENT_CHUNK) {
+        long end = begin + JADWAL_CONCURRENT_CHUNK < nbuckets ? begin + JADWAL_CONCURRENT_CHUNK : nbuckets;
+        long n = jadwal_concurrent_copy_chunk__(src, begin, end, stage);
+        for (long i = 0; i < n && rv == JADWAL_OK; i++) {
+            //a key that was removed and inserted again can show up twice, the log sorts out which value wins
+            rv = jadwal_concurrent_put__(dst, &stage->keys[i], &stage->values[i], false);
+            if (rv == JADWAL_DUPLICATE_KEY)
+                rv = JADWAL_OK;
+        }
+    }
+    dst->memfuncs.free(stage, dst->userdata);
+    return rv;
+}
+
+//called with the lock held, replays the log into next and publishes it, or drops it if copy_rv isn't JADWAL_OK
+static void jadwal_concurrent_finish_build__(struct jadwal_concurrent *c, int copy_rv) {
+    struct jadwal_concurrent_table *next = c->next;
+    int rv = copy_rv;
+    for (long i = 0; i < c->log_len && rv == JADWAL_OK; i++) {
+        struct jadwal_concurrent_log_entry *entry = &c->log[i];
+        if (entry->op == JADWAL_CONCURRENT_OP_INSERT) {
+            rv = jadwal_concurrent_put__(&next->ht, &entry->key, &entry->value, true);
+        }
+        else {
+            rv = jadwal_remove(&next->ht, &entry->key);
+            if (rv == JADWAL_NOT_FOUND)
+                rv = JADWAL_OK;
+        }
+    }
+    if (rv == JADWAL_OK) {
+        struct jadwal_concurrent_table *old = c->current;
+        __atomic_store_n(&c->current, next, __ATOMIC_SEQ_CST);
+        old->retired_epoch = c->epoch;
+        __atomic_store_n(&c->epoch, c->epoch + 1, __ATOMIC_SEQ_CST);
+        old->retired_next = c->retired;
+        c->retired = old;
+        c->nbuilds++;
+    }
+    else {
+        jadwal_concurrent_table_free__(next);
+    }
+    c->next = NULL;
+    c->log_len = 0;
+    c->build_rv = rv;
+    c->building = false;
+    jadwal_concurrent_reclaim__(c);
+    pthread_cond_broadcast(&c->build_done);
+}
+
+static void *jadwal_concurrent_builder_main__(void *arg) {
+    struct jadwal_concurrent *c = arg;
+    int rv = jadwal_concurrent_copy__(c);
+    pthread_mutex_lock(&c->write_lock);
+    jadwal_concurrent_finish_build__(c, rv);
+    pthread_mutex_unlock(&c->write_lock);
+    return NULL;
+}
+
+//called with the lock held, a purge builds a table sized for the elements there are now (without the tombstones)
+static int jadwal_concurrent_start_build__(struct jadwal_concurrent *c, bool purge) {
+    struct jadwal *ht = &c->current->ht;
+    long size = ht->nelements;
+    if (!purge) {
+        size = jadwal_resize_nbuckets__(ht, ht->nelements);
+        if (size == 0)
+            return JADWAL_FAILED_AT_RESIZE;
+    }
+    c->next = jadwal_concurrent_table_alloc__(ht, size);
+    if (!c->next)
+        return JADWAL_ALLOC_ERR;
+    c->building = true;
+    c->build_rv = JADWAL_OK;
+    c->log_len = 0;
+    if (c->builder_joinable) {
+        //the previous builder already gave up the lock, it's only returning
+        pthread_join(c->builder, NULL);
+        c->builder_joinable = false;
+    }
+    if (pthread_create(&c->builder, NULL, jadwal_concurrent_builder_main__, c) == 0) {
+        c->builder_joinable = true;
+        return JADWAL_OK;
+    }
+    //no thread, build it here with the lock held, readers still go on
+    jadwal_concurrent_finish_build__(c, jadwal_concurrent_copy__(c));
+    return c->build_rv;
+}
+
+//one empty bucket more than jadwal.h needs, a reader can read the counters of the table half way through an insert or
+//a remove (nelements already changed but ndeleted not yet, or the other way around) and be off by one
+static bool jadwal_concurrent_full__(struct jadwal *ht) {
+    return jadwal_at_insert_must_resize(ht) || jadwal_n_empty_buckets(ht) <= 2;
+}
+
+//called with the lock held, makes sure the live table can take one more element, and the log one more entry
+static int jadwal_concurrent_make_room__(struct jadwal_concurrent *c) {
+    while (1) {
+        struct jadwal_concurrent_table *t = c->current;
+        struct jadwal *ht = &t->ht;
+        if (!c->building) {
+            bool full = jadwal_concurrent_full__(ht);
+            if (ht->nelements >= ht->grow_at_gt_n) {
+                int rv = jadwal_concurrent_start_build__(c, false);
+                if (rv == JADWAL_OK)
+                    continue; //the build may have been done right here
+                if (full)
+                    return rv;
+                //try again on the next write
+            }
+            else if (ht->ndeleted > 0 && (ht->ndeleted > ht->purge_at_gt_n || full)) {
+                //like growing, the builder copies the live elements to a new table and publishes it
+                int rv = jadwal_concurrent_start_build__(c, true);
+                if (rv == JADWAL_OK)
+                    continue;
+                if (full) {
+                    //nothing else left, in place, readers wait for all of it
+                    jadwal_concurrent_write_begin__(t);
+                    jadwal_purge_tombstones__(ht);
+                    jadwal_concurrent_write_end__(t);
+                    c->npurges_in_place++;
+                }
+            }
+        }
+        if (c->building && c->log_len == c->log_cap) {
+            long new_cap = c->log_cap ? c->log_cap * 2 : 64;
+            void *log = ht->memfuncs.realloc(c->log, new_cap * sizeof c->log[0], ht->userdata);
+            if (!log)
+                return JADWAL_ALLOC_ERR;
+            c->log = log;
+            c->log_cap = new_cap;
+        }
+        //during a build the live table keeps filling past grow_at, but only half way to full, probes get long after that
+        long wait_at = ht->grow_at_gt_n + (ht->nbuckets - ht->grow_at_gt_n) / 2;
+        if (!jadwal_concurrent_full__(ht) && (!c->building || ht->nelements < wait_at))
+            return JADWAL_OK;
+        if (!c->building)
+            return JADWAL_FAILED_AT_RESIZE;
+        //this is the only time a writer waits for the builder
+        pthread_cond_wait(&c->build_done, &c->write_lock);
+        if (c->build_rv != JADWAL_OK) {
+            int rv = c->build_rv;
+            c->build_rv = JADWAL_OK;
+            return rv;
+        }
+    }
+}
+
+static void jadwal_concurrent_log__(struct jadwal_concurrent *c, int op, jadwal_key_type *key, jadwal_value_type *value) {
+    if (!c->building)
+        return;
+    JADWAL_ASSERT(c->log_len < c->log_cap, "jadwal_concurrent_make_room__() reserves the entry");
+    struct jadwal_concurrent_log_entry *entry = &c->log[c->log_len++];
+    entry->op = op;
+    memcpy(&entry->key, key, sizeof *key);
+    if (value)
+        memcpy(&entry->value, value, sizeof *value);
+}
+
+static int jadwal_concurrent_init_with_udata(struct jadwal_concurrent *c, long initial_nelements, void *userdata) {
+    struct jadwal_concurrent_table *t = jadwal_def_malloc(sizeof *t, userdata);
+    if (!t)
+        return JADWAL_ALLOC_ERR;
+    int rv = jadwal_init_with_udata(&t->ht, initial_nelements, userdata);
+    if (rv != JADWAL_OK) {
+        jadwal_def_free(t, userdata);
+        return rv;
+    }
+    t->seq = 0;
+    t->retired_next = NULL;
+    t->retired_epoch = 0;
+    c->current = t;
+    c->nreaders = 0;
+    c->epoch = 1;
+    pthread_mutex_init(&c->write_lock, NULL);
+    pthread_cond_init(&c->build_done, NULL);
+    c->building = false;
+    c->builder_joinable = false;
+    c->build_rv = JADWAL_OK;
+    c->next = NULL;
+    c->log = NULL;
+    c->log_len = 0;
+    c->log_cap = 0;
+    c->retired = NULL;
+    c->readers = NULL;
+    c->nbuilds = 0;
+    c->npurges_in_place = 0;
+    return JADWAL_OK;
+}
+static int jadwal_concurrent_init(struct jadwal_concurrent *c, long initial_nelements) {
+    return jadwal_concurrent_init_with_udata(c, initial_nelements, NULL);
+}
+
+//no other thread may be using the table anymore, the readers must have been deinitialized
+static void jadwal_concurrent_deinit(struct jadwal_concurrent *c) {
+    pthread_mutex_lock(&c->write_lock);
+    while (c->building)
+        pthread_cond_wait(&c->build_done, &c->write_lock);
+    pthread_mutex_unlock(&c->write_lock);
+    if (c->builder_joinable)
+        pthread_join(c->builder, NULL);
+    JADWAL_ASSERT(!c->readers, "a reader is still registered");
+    struct jadwal_alloc_funcs memfuncs = c->current->ht.memfuncs;
+    void *userdata = c->current->ht.userdata;
+    memfuncs.free(c->log, userdata);
+    jadwal_concurrent_reclaim__(c);
+    jadwal_concurrent_table_free__(c->current);
+    c->current = NULL;
+    pthread_cond_destroy(&c->build_done);
+    pthread_mutex_destroy(&c->write_lock);
+}
+
+//waits until a build in progress (if any) is published
+static void jadwal_concurrent_wait(struct jadwal_concurrent *c) {
+    pthread_mutex_lock(&c->write_lock);
+    while (c->building)
+        pthread_cond_wait(&c->build_done, &c->write_lock);
+    pthread_mutex_unlock(&c->write_lock);
+}
+
+static long jadwal_concurrent_count(struct jadwal_concurrent *c) {
+    pthread_mutex_lock(&c->write_lock);
+    long count = c->current->ht.nelements;
+    pthread_mutex_unlock(&c->write_lock);
+    return count;
+}
+
+//returns JADWAL_OK or JADWAL_DUPLICATE_KEY (the value isn't replaced then), or an error
+static int jadwal_concurrent_insert(struct jadwal_concurrent *c, jadwal_key_type *key, jadwal_value_type *value) {
+    pthread_mutex_lock(&c->write_lock);
+    int rv = jadwal_concurrent_make_room__(c);
+    if (rv == JADWAL_OK) {
+        struct jadwal_concurrent_table *t = c->current;
+        jadwal_concurrent_write_begin__(t);
+        rv = jadwal_insert(&t->ht, key, value);
+        jadwal_concurrent_write_end__(t);
+        if (rv == JADWAL_OK)
+            jadwal_concurrent_log__(c, JADWAL_CONCURRENT_OP_INSERT, key, value);
+        jadwal_concurrent_reclaim__(c);
+    }
+    pthread_mutex_unlock(&c->write_lock);
+    return rv;
+}
+
+static int jadwal_concurrent_remove(struct jadwal_concurrent *c, jadwal_key_type *key) {
+    pthread_mutex_lock(&c->write_lock);
+    int rv = jadwal_concurrent_make_room__(c); //only for the log entry
+    if (rv == JADWAL_OK) {
+        struct jadwal_concurrent_table *t = c->current;
+        jadwal_concurrent_write_begin__(t);
+        rv = jadwal_remove(&t->ht, key);
+        jadwal_concurrent_write_end__(t);
+        if (rv == JADWAL_OK)
+            jadwal_concurrent_log__(c, JADWAL_CONCURRENT_OP_REMOVE, key, NULL);
+        jadwal_concurrent_reclaim__(c);
+    }
+    pthread_mutex_unlock(&c->write_lock);
+    return rv;
+}
+
+//looks key up in t under its sequence counter
+static int jadwal_concurrent_find_in__(struct jadwal_concurrent_table *t, jadwal_key_type *key, jadwal_value_type *value_out) {
+    size_t full_hash = jadwal_key_hash__(&t->ht, key);
+    jadwal_value_type value;
+    memset(&value, 0, sizeof value); //only to keep compilers quiet, it's copied out only when found
+    int rv;
+    unsigned long seq;
+    do {
+        seq = jadwal_concurrent_read_begin__(t);
+        long idx;
+        rv = jadwal_find_pos_hashed__(&t->ht, key, full_hash, &idx);
+        if (rv == JADWAL_OK)
+            memcpy(&value, jadwal_value_at(&t->ht, idx), sizeof value);
+    } while (!jadwal_concurrent_read_end__(t, seq));
+    if (rv == JADWAL_OK && value_out)
+        memcpy(value_out, &value, sizeof value);
+    return rv;
+}
+
+//doesn't wait for a build or for the lock, only for a writer in the middle of a single insert / remove (see the top of
+//the file), copies the value to value_out (if it isn't NULL)
+//returns JADWAL_OK or JADWAL_NOT_FOUND
+static int jadwal_concurrent_find(struct jadwal_concurrent *c, jadwal_key_type *key, jadwal_value_type *value_out) {
+    __atomic_fetch_add(&c->nreaders, 1, __ATOMIC_SEQ_CST);
+    struct jadwal_concurrent_table *t = __atomic_load_n(&c->current, __ATOMIC_SEQ_CST);
+    int rv = jadwal_concurrent_find_in__(t, key, value_out);
+    __atomic_fetch_sub(&c->nreaders, 1, __ATOMIC_RELEASE);
+    return rv;
+}
+
+//registers r with c, a reader is used by one thread at a time
+static void jadwal_concurrent_reader_init(struct jadwal_concurrent *c, struct jadwal_concurrent_reader *r) {
+    r->epoch = 0;
+    r->c = c;
+    pthread_mutex_lock(&c->write_lock);
+    r->next = c->readers;
+    c->readers = r;
+    pthread_mutex_unlock(&c->write_lock);
+}
+
+//must not be in the middle of a lookup
+static void jadwal_concurrent_reader_deinit(struct jadwal_concurrent_reader *r) {
+    struct jadwal_concurrent *c = r->c;
+    pthread_mutex_lock(&c->write_lock);
+    struct jadwal_concurrent_reader **link = &c->readers;
+    while (*link != r)
+        link = &(*link)->next;
+    *link = r->next;
+    jadwal_concurrent_reclaim__(c);
+    pthread_mutex_unlock(&c->write_lock);
+    r->c = NULL;
+}
+
+//jadwal_concurrent_find() without the shared counter, the only write is to r
+static int jadwal_concurrent_reader_find(struct jadwal_concurrent_reader *r, jadwal_key_type *key, jadwal_value_type *value_out) {
+    struct jadwal_concurrent *c = r->c;
+    JADWAL_ASSERT(c && r->epoch == 0, "the reader isn't registered, or is used by two threads");
+    //the announcement must be visible before current is read, a writer that misses it sees a later current published
+    __atomic_store_n(&r->epoch, __atomic_load_n(&c->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    struct jadwal_concurrent_table *t = __atomic_load_n(&c->current, __ATOMIC_SEQ_CST);
+    int rv = jadwal_concurrent_find_in__(t, key, value_out);
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+    return rv;
+}
@@ -0,0 +1,430 @@
+/*
+Copyright 2019 Turki Alsaleem
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+bucketized cuckoo hashing, an alternative to struct jadwal with a bounded lookup
+
+the same things have to be defined before including this as for jadwal.h (jadwal_key_type, jadwal_value_type,
+jadwal_hash(), jadwal_key_eq_cmp() and optionally JADWAL_DATA_ARG), jadwal.h is included from here if it wasn't
+already, so both tables can be used in the same file
+
+every key lives in one of two buckets, each bucket has JADWAL_CUCKOO_SLOTS slots and starts on a 64 byte line:
+    [tags: 1 byte per slot] [keys] [values] [padding up to a multiple of 64]
+a find or a remove looks at the tags of the two buckets and compares keys only on a tag hit, so as long as a bucket
+fits in 64 bytes (for example 4 slots of int/int, or of pointer/int) a hit or a miss touches at most two cache lines
+
+the second bucket is the first one xor'd with a value derived from the tag, so an element can be moved to its other
+bucket without hashing its key again, which needs a power of two bucket count
+inserting into two full buckets searches (breadth first) for the shortest chain of moves that frees a slot,
+if there is none within JADWAL_CUCKOO_BFS_NODES buckets the table doubles
+
+the api mirrors jadwal.h with a jadwal_cuckoo_ prefix: init / init_ex / deinit / insert / find / find_or_insert /
+remove, and iterators (struct jadwal_cuckoo_iter, use jadwal_cuckoo_iter_key() / jadwal_cuckoo_iter_value())
+unlike struct jadwal, removing elements while iterating is fine (nothing ever moves on removal)
+
+optional defines (compile time):
+    JADWAL_CUCKOO_SLOTS       slots per bucket (default 4, max 8)
+    JADWAL_CUCKOO_BFS_NODES   how many buckets an insertion looks at before giving up and growing (default 128)
+*/
+
+#ifdef JADWAL_CUCKOO_H
+#error "the header can only be safely included once"
+#endif // #ifdef JADWAL_CUCKOO_H
+#define JADWAL_CUCKOO_H
+
+#ifndef JADWAL_H
+#include "jadwal.h"
+#endif
+
+#ifndef JADWAL_CUCKOO_SLOTS
+    #define JADWAL_CUCKOO_SLOTS 4
+#endif
+#if JADWAL_CUCKOO_SLOTS < 1 || JADWAL_CUCKOO_SLOTS > 8
+    #error "JADWAL_CUCKOO_SLOTS must be in [1, 8]"
+#endif
+#ifndef JADWAL_CUCKOO_BFS_NODES
+    #define JADWAL_CUCKOO_BFS_NODES 128
+#endif
+
+#define JADWAL_CUCKOO_LINE 64
+#define JADWAL_CUCKOO_TAG_EMPTY 0
+
+struct jadwal_cuckoo_bucket {
+    unsigned char tags[JADWAL_CUCKOO_SLOTS]; //JADWAL_CUCKOO_TAG_EMPTY or the tag of the key in the slot
+    jadwal_key_type   keys[JADWAL_CUCKOO_SLOTS];
+    jadwal_value_type values[JADWAL_CUCKOO_SLOTS];
+};
+//buckets are laid out with this stride, so every bucket starts on a line
+#define JADWAL_CUCKOO_BUCKET_STRIDE \
+    ((sizeof(struct jadwal_cuckoo_bucket) + JADWAL_CUCKOO_LINE - 1) / JADWAL_CUCKOO_LINE * JADWAL_CUCKOO_LINE)
+
+struct jadwal_cuckoo {
+    unsigned char *buckets; //aligned to JADWAL_CUCKOO_LINE, inside mem
+    void *mem;
+    long nelements;
+    long nbuckets; //power of two
+    long nbuckets_po2;
+    struct jadwal_alloc_funcs memfuncs;
+    void *userdata;
+};
+
+struct jadwal_cuckoo_iter {
+    long current_idx; //bucket * JADWAL_CUCKOO_SLOTS + slot
+    jadwal_key_type   *key;
+    jadwal_value_type *value;
+};
+
+static struct jadwal_cuckoo_bucket *jadwal_cuckoo_bucket_at(struct jadwal_cuckoo *ht, long bucket_idx) {
+    JADWAL_ASSERT(bucket_idx >= 0 && bucket_idx < ht->nbuckets, "");
+    return (struct jadwal_cuckoo_bucket *) (ht->buckets + bucket_idx * JADWAL_CUCKOO_BUCKET_STRIDE);
+}
+
+static size_t jadwal_cuckoo_hash__(struct jadwal_cuckoo *ht, jadwal_key_type *key) {
+    (void) ht;
+#ifdef JADWAL_DATA_ARG
+    return jadwal_hash(ht->userdata, key);
+#else
+    return jadwal_hash(key);
+#endif
+}
+//returns 0 if equal, key2 is the one stored in the table
+static int jadwal_cuckoo_key_cmp__(struct jadwal_cuckoo *ht, jadwal_key_type *key1, jadwal_key_type *key2) {
+    (void) ht;
+#ifdef JADWAL_DATA_ARG
+    return jadwal_key_eq_cmp(ht->userdata, key1, key2);
+#else
+    return jadwal_key_eq_cmp(key1, key2);
+#endif
+}
+
+//the hash is mixed first (fibonacci hashing), the bucket comes from the top bits and the tag from the bits below them
+//so weak hashes like the identity of a small integer still spread over the whole table
+static uint64_t jadwal_cuckoo_mix(size_t full_hash) {
+    return (uint64_t) full_hash * 0x9E3779B97F4A7C15ULL;
+}
+static unsigned char jadwal_cuckoo_tag(uint64_t mixed) {
+    unsigned char tag = (unsigned char) (mixed >> 24);
+    return tag == JADWAL_CUCKOO_TAG_EMPTY ? 1 : tag;
+}
+static long jadwal_cuckoo_first_bucket(struct jadwal_cuckoo *ht, uint64_t mixed) {
+    return (long) (mixed >> (64 - ht->nbuckets_po2));
+}
+//the other bucket of an element in bucket_idx, applying it twice gives bucket_idx back
+//the xor'd value is odd, so the two buckets are always different
+static long jadwal_cuckoo_alt_bucket(struct jadwal_cuckoo *ht, long bucket_idx, unsigned char tag) {
+    unsigned long tag_hash = ((unsigned long) tag * 0x5BD1E995UL) | 1;
+    return (long) (((unsigned long) bucket_idx ^ tag_hash) & (unsigned long) (ht->nbuckets - 1));
+}
+
+static int jadwal_cuckoo_alloc_buckets__(struct jadwal_cuckoo *ht, long nbuckets_po2) {
+    long nbuckets = 1L << nbuckets_po2;
+    void *mem = ht->memfuncs.alloc(nbuckets * JADWAL_CUCKOO_BUCKET_STRIDE + JADWAL_CUCKOO_LINE - 1, ht->userdata);
+    if (!mem)
+        return JADWAL_ALLOC_ERR;
+    ht->mem = mem;
+    ht->buckets = (unsigned char *) (((uintptr_t) mem + JADWAL_CUCKOO_LINE - 1) & ~(uintptr_t) (JADWAL_CUCKOO_LINE - 1));
+    ht->nbuckets = nbuckets;
+    ht->nbuckets_po2 = nbuckets_po2;
+    ht->nelements = 0;
+    memset(ht->buckets, 0, nbuckets * JADWAL_CUCKOO_BUCKET_STRIDE); //all tags empty
+    return JADWAL_OK;
+}
+
+static int jadwal_cuckoo_init_ex(struct jadwal_cuckoo *ht,
+                                 long initial_nelements,
+                                 jadwal_malloc_fptr alloc,
+                                 jadwal_realloc_fptr realloc,
+                                 jadwal_free_fptr free,
+                                 void *userdata)
+{
+    const struct jadwal_alloc_funcs memfuncs = { alloc, realloc, free, };
+    ht->memfuncs = memfuncs;
+    ht->userdata = userdata;
+    //aim for about half full buckets
+    long nbuckets_po2 = 1;
+    while (nbuckets_po2 < 30 && (1L << nbuckets_po2) * JADWAL_CUCKOO_SLOTS < initial_nelements * 2)
+        nbuckets_po2++;
+    return jadwal_cuckoo_alloc_buckets__(ht, nbuckets_po2);
+}
+static int jadwal_cuckoo_init_with_udata(struct jadwal_cuckoo *ht, long initial_nelements, void *userdata) {
+    return jadwal_cuckoo_init_ex(ht, initial_nelements, jadwal_def_malloc, jadwal_def_realloc, jadwal_def_free, userdata);
+}
+static int jadwal_cuckoo_init(struct jadwal_cuckoo *ht, long initial_nelements) {
+    return jadwal_cuckoo_init_with_udata(ht, initial_nelements, NULL);
+}
+static void jadwal_cuckoo_deinit(struct jadwal_cuckoo *ht) {
+    ht->memfuncs.free(ht->mem, ht->userdata);
+    ht->mem = NULL;
+    ht->buckets = NULL;
+    ht->nbuckets = 0;
+    ht->nbuckets_po2 = 0;
+    ht->nelements = 0;
+}
+
+//returns the slot of key in bucket_idx or -1
+static int jadwal_cuckoo_find_in_bucket__(struct jadwal_cuckoo *ht, long bucket_idx, unsigned char tag, jadwal_key_type *key) {
+    struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, bucket_idx);
+    for (int i=0; i<JADWAL_CUCKOO_SLOTS; i++) {
+        if (bucket->tags[i] == tag && jadwal_cuckoo_key_cmp__(ht, key, &bucket->keys[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+static int jadwal_cuckoo_free_slot__(struct jadwal_cuckoo *ht, long bucket_idx) {
+    struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, bucket_idx);
+    for (int i=0; i<JADWAL_CUCKOO_SLOTS; i++) {
+        if (bucket->tags[i] == JADWAL_CUCKOO_TAG_EMPTY)
+            return i;
+    }
+    return -1;
+}
+
+//looks in both buckets, on success out_idx is bucket * JADWAL_CUCKOO_SLOTS + slot
+static int jadwal_cuckoo_find_pos__(struct jadwal_cuckoo *ht, jadwal_key_type *key, long *out_idx) {
+    uint64_t mixed = jadwal_cuckoo_mix(jadwal_cuckoo_hash__(ht, key));
+    unsigned char tag = jadwal_cuckoo_tag(mixed);
+    long b1 = jadwal_cuckoo_first_bucket(ht, mixed);
+    long b2 = jadwal_cuckoo_alt_bucket(ht, b1, tag);
+    int slot = jadwal_cuckoo_find_in_bucket__(ht, b1, tag, key);
+    if (slot >= 0) {
+        *out_idx = b1 * JADWAL_CUCKOO_SLOTS + slot;
+        return JADWAL_OK;
+    }
+    slot = jadwal_cuckoo_find_in_bucket__(ht, b2, tag, key);
+    if (slot >= 0) {
+        *out_idx = b2 * JADWAL_CUCKOO_SLOTS + slot;
+        return JADWAL_OK;
+    }
+    *out_idx = JADWAL_NOT_FOUND;
+    return JADWAL_NOT_FOUND;
+}
+
+//breadth first search for a chain of moves that ends in a free slot, starting from the two full buckets b1, b2
+//every node is a bucket, a child is the other bucket of one of the elements in its parent
+//on success the moves are done back to front (each one fills the slot the previous one freed) and the slot freed in
+//b1 or b2 is returned as bucket * JADWAL_CUCKOO_SLOTS + slot
+struct jadwal_cuckoo_bfs_node {
+    long bucket_idx;
+    int parent;      //index into the queue, -1 for b1 and b2
+    int parent_slot; //the slot in the parent bucket whose element moves into this bucket
+};
+static long jadwal_cuckoo_make_room__(struct jadwal_cuckoo *ht, long b1, long b2) {
+    struct jadwal_cuckoo_bfs_node queue[JADWAL_CUCKOO_BFS_NODES];
+    int head = 0;
+    int tail = 0;
+    queue[tail].bucket_idx = b1; queue[tail].parent = -1; queue[tail].parent_slot = -1; tail++;
+    queue[tail].bucket_idx = b2; queue[tail].parent = -1; queue[tail].parent_slot = -1; tail++;
+
+    while (head < tail) {
+        int node = head++;
+        long bucket_idx = queue[node].bucket_idx;
+        int free_slot = jadwal_cuckoo_free_slot__(ht, bucket_idx);
+        if (free_slot >= 0) {
+            //walk back to the root, moving each parent element into the slot that just got freed
+            while (queue[node].parent >= 0) {
+                struct jadwal_cuckoo_bucket *dst = jadwal_cuckoo_bucket_at(ht, queue[node].bucket_idx);
+                long src_idx = queue[queue[node].parent].bucket_idx;
+                struct jadwal_cuckoo_bucket *src = jadwal_cuckoo_bucket_at(ht, src_idx);
+                int src_slot = queue[node].parent_slot;
+                //a bucket can show up twice on a path, in that case an earlier move may have already emptied
+                //the source, the table is still consistent, the insertion just grows instead
+                if (src->tags[src_slot] == JADWAL_CUCKOO_TAG_EMPTY || dst->tags[free_slot] != JADWAL_CUCKOO_TAG_EMPTY)
+                    return JADWAL_NOT_FOUND;
+                JADWAL_ASSERT(jadwal_cuckoo_alt_bucket(ht, src_idx, src->tags[src_slot]) == queue[node].bucket_idx, "");
+                dst->tags[free_slot] = src->tags[src_slot];
+                memcpy(&dst->keys[free_slot], &src->keys[src_slot], sizeof(jadwal_key_type));
+                memcpy(&dst->values[free_slot], &src->values[src_slot], sizeof(jadwal_value_type));
+                src->tags[src_slot] = JADWAL_CUCKOO_TAG_EMPTY;
+                free_slot = src_slot;
+                node = queue[node].parent;
+            }
+            return queue[node].bucket_idx * JADWAL_CUCKOO_SLOTS + free_slot;
+        }
+        struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, bucket_idx);
+        for (int i=0; i<JADWAL_CUCKOO_SLOTS && tail < JADWAL_CUCKOO_BFS_NODES; i++) {
+            queue[tail].bucket_idx = jadwal_cuckoo_alt_bucket(ht, bucket_idx, bucket->tags[i]);
+            queue[tail].parent = node;
+            queue[tail].parent_slot = i;
+            tail++;
+        }
+    }
+    return JADWAL_NOT_FOUND;
+}
+
+//places a key that is known not to be in the table, returns JADWAL_NOT_FOUND if there is no room without growing
+static int jadwal_cuckoo_place__(struct jadwal_cuckoo *ht, uint64_t mixed, jadwal_key_type *key, jadwal_value_type *value, long *out_idx) {
+    unsigned char tag = jadwal_cuckoo_tag(mixed);
+    long b1 = jadwal_cuckoo_first_bucket(ht, mixed);
+    long b2 = jadwal_cuckoo_alt_bucket(ht, b1, tag);
+    long idx;
+    int slot;
+    if ((slot = jadwal_cuckoo_free_slot__(ht, b1)) >= 0)
+        idx = b1 * JADWAL_CUCKOO_SLOTS + slot;
+    else if ((slot = jadwal_cuckoo_free_slot__(ht, b2)) >= 0)
+        idx = b2 * JADWAL_CUCKOO_SLOTS + slot;
+    else if ((idx = jadwal_cuckoo_make_room__(ht, b1, b2)) < 0)
+        return JADWAL_NOT_FOUND;
+
+    struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, idx / JADWAL_CUCKOO_SLOTS);
+    slot = idx % JADWAL_CUCKOO_SLOTS;
+    bucket->tags[slot] = tag;
+    memcpy(&bucket->keys[slot], key, sizeof(jadwal_key_type));
+    memcpy(&bucket->values[slot], value, sizeof(jadwal_value_type));
+    ht->nelements++;
+    *out_idx = idx;
+    return JADWAL_OK;
+}
+
+//doubles the bucket count (more than once if an element doesn't fit, which is very unlikely)
+static int jadwal_cuckoo_grow__(struct jadwal_cuckoo *ht) {
+    long new_po2 = ht->nbuckets_po2 + 1;
+    while (1) {
+        if (new_po2 > 30)
+            return JADWAL_INVALID_REQ_SZ;
+        struct jadwal_cuckoo new_ht = *ht;
+        int rv = jadwal_cuckoo_alloc_buckets__(&new_ht, new_po2);
+        if (rv != JADWAL_OK)
+            return rv;
+        for (long b=0; b<ht->nbuckets && rv == JADWAL_OK; b++) {
+            struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, b);
+            for (int i=0; i<JADWAL_CUCKOO_SLOTS && rv == JADWAL_OK; i++) {
+                if (bucket->tags[i] == JADWAL_CUCKOO_TAG_EMPTY)
+                    continue;
+                long unused_idx;
+                uint64_t mixed = jadwal_cuckoo_mix(jadwal_cuckoo_hash__(ht, &bucket->keys[i]));
+                rv = jadwal_cuckoo_place__(&new_ht, mixed, &bucket->keys[i], &bucket->values[i], &unused_idx);
+            }
+        }
+        if (rv == JADWAL_OK) {
+            JADWAL_ASSERT(new_ht.nelements == ht->nelements, "");
+            jadwal_cuckoo_deinit(ht);
+            *ht = new_ht;
+            return JADWAL_OK;
+        }
+        jadwal_cuckoo_deinit(&new_ht);
+        new_po2++;
+    }
+}
+
+static int jadwal_cuckoo_insert__(struct jadwal_cuckoo *ht, jadwal_key_type *key, jadwal_value_type *value, long *out_idx) {
+    int rv = jadwal_cuckoo_find_pos__(ht, key, out_idx);
+    if (rv == JADWAL_OK)
+        return JADWAL_DUPLICATE_KEY;
+    uint64_t mixed = jadwal_cuckoo_mix(jadwal_cuckoo_hash__(ht, key));
+    while ((rv = jadwal_cuckoo_place__(ht, mixed, key, value, out_idx)) == JADWAL_NOT_FOUND) {
+        rv = jadwal_cuckoo_grow__(ht);
+        if (rv != JADWAL_OK) {
+            *out_idx = JADWAL_NOT_FOUND;
+            return rv == JADWAL_ALLOC_ERR ? rv : JADWAL_FAILED_AT_RESIZE;
+        }
+    }
+    return rv;
+}
+
+static void jadwal_cuckoo_iter_set__(struct jadwal_cuckoo *ht, struct jadwal_cuckoo_iter *iter, long idx) {
+    struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, idx / JADWAL_CUCKOO_SLOTS);
+    iter->current_idx = idx;
+    iter->key   = &bucket->keys[idx % JADWAL_CUCKOO_SLOTS];
+    iter->value = &bucket->values[idx % JADWAL_CUCKOO_SLOTS];
+}
+static struct jadwal_cuckoo_iter jadwal_cuckoo_mk_invalid_iter(void) {
+    struct jadwal_cuckoo_iter iter = {JADWAL_ITER_STOP, NULL, NULL};
+    return iter;
+}
+static jadwal_key_type *jadwal_cuckoo_iter_key(struct jadwal_cuckoo_iter *iter) {
+    return iter->key;
+}
+static jadwal_value_type *jadwal_cuckoo_iter_value(struct jadwal_cuckoo_iter *iter) {
+    return iter->value;
+}
+static bool jadwal_cuckoo_iter_check(struct jadwal_cuckoo_iter *iter) {
+    JADWAL_ASSERT((iter->current_idx == JADWAL_ITER_STOP) || (iter->key != NULL && iter->current_idx >= 0), "invalid iterator state");
+    return iter->current_idx != JADWAL_ITER_STOP;
+}
+//the first occupied slot at or after idx
+static int jadwal_cuckoo_iter_seek__(struct jadwal_cuckoo *ht, struct jadwal_cuckoo_iter *iter, long idx) {
+    for (; idx < ht->nbuckets * JADWAL_CUCKOO_SLOTS; idx++) {
+        if (jadwal_cuckoo_bucket_at(ht, idx / JADWAL_CUCKOO_SLOTS)->tags[idx % JADWAL_CUCKOO_SLOTS] != JADWAL_CUCKOO_TAG_EMPTY) {
+            jadwal_cuckoo_iter_set__(ht, iter, idx);
+            return JADWAL_OK;
+        }
+    }
+    *iter = jadwal_cuckoo_mk_invalid_iter();
+    return JADWAL_ITER_STOP;
+}
+static int jadwal_cuckoo_begin_iterator(struct jadwal_cuckoo *ht, struct jadwal_cuckoo_iter *iter) {
+    return jadwal_cuckoo_iter_seek__(ht, iter, 0);
+}
+static int jadwal_cuckoo_iter_next(struct jadwal_cuckoo *ht, struct jadwal_cuckoo_iter *iter) {
+    if (iter->current_idx == JADWAL_ITER_STOP)
+        return JADWAL_ITER_STOP;
+    JADWAL_ASSERT(iter->current_idx >= 0 && iter->current_idx < ht->nbuckets * JADWAL_CUCKOO_SLOTS, "invalid iterator");
+    return jadwal_cuckoo_iter_seek__(ht, iter, iter->current_idx + 1);
+}
+
+static int jadwal_cuckoo_insert(struct jadwal_cuckoo *ht, jadwal_key_type *key, jadwal_value_type *value) {
+    long idx_unused;
+    return jadwal_cuckoo_insert__(ht, key, value, &idx_unused);
+}
+static int jadwal_cuckoo_find(struct jadwal_cuckoo *ht, jadwal_key_type *key, struct jadwal_cuckoo_iter *out) {
+    long found_idx;
+    int rv = jadwal_cuckoo_find_pos__(ht, key, &found_idx);
+    if (rv != JADWAL_OK) {
+        *out = jadwal_cuckoo_mk_invalid_iter();
+        return rv;
+    }
+    jadwal_cuckoo_iter_set__(ht, out, found_idx);
+    return JADWAL_OK;
+}
+//like jadwal_find_or_insert(), an existing element gets key and value overwritten
+static int jadwal_cuckoo_find_or_insert(struct jadwal_cuckoo *ht, jadwal_key_type *key, jadwal_value_type *value, struct jadwal_cuckoo_iter *out) {
+    long found_idx;
+    int rv = jadwal_cuckoo_insert__(ht, key, value, &found_idx);
+    if (rv == JADWAL_DUPLICATE_KEY) {
+        jadwal_cuckoo_iter_set__(ht, out, found_idx);
+        memcpy(out->key, key, sizeof(jadwal_key_type));
+        memcpy(out->value, value, sizeof(jadwal_value_type));
+        return JADWAL_OK;
+    }
+    if (rv == JADWAL_OK)
+        jadwal_cuckoo_iter_set__(ht, out, found_idx);
+    else
+        *out = jadwal_cuckoo_mk_invalid_iter();
+    return rv;
+}
+static int jadwal_cuckoo_remove(struct jadwal_cuckoo *ht, jadwal_key_type *key) {
+    long found_idx;
+    int rv = jadwal_cuckoo_find_pos__(ht, key, &found_idx);
+    if (rv != JADWAL_OK)
+        return rv;
+    jadwal_cuckoo_bucket_at(ht, found_idx / JADWAL_CUCKOO_SLOTS)->tags[found_idx % JADWAL_CUCKOO_SLOTS] = JADWAL_CUCKOO_TAG_EMPTY;
+    ht->nelements--;
+    return JADWAL_OK;
+}
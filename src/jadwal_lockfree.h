@@ -0,0 +1,494 @@
+/*
+Copyright 2019 Turki Alsaleem
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+/*
+a wrapper around struct jadwal that many threads insert into, remove from and look up in at the same time without
+locks, link with -pthread
+
+the same things have to be defined before including this as for jadwal.h, jadwal.h is included from here (so it must
+not have been included before)
+
+every thread gets a struct jadwal_lockfree_handle (jadwal_lockfree_handle_init()) and passes it to every call
+the state of a bucket is its pair_data word (flags and partial hash), it goes through:
+    empty -> busy (claimed with a compare and swap, the key and value are being written)
+          -> occupied (published with release ordering) -> deleted (a tombstone, never reused)
+and every state can also be frozen, which a resize does to every bucket before it copies it
+lookups read the word with acquire ordering and only read the key of an occupied bucket, they go past a busy one (its
+insert hasn't completed, so the lookup happens before it) and never wait, inserts of the same key meet at the same
+bucket (buckets are claimed in probe order and never become empty again), the second one waits there until the first
+one has published its key, which is only the few instructions it takes to copy a key and value (a remove that meets a
+busy bucket with its key's partial hash waits the same way)
+
+when the buckets that are in use (occupied, deleted or busy) reach the grow threshold the table is replaced: the thread
+that notices allocates the next table (sized for the elements that are left, so a table that is mostly tombstones is
+rehashed at the same size or smaller), then every thread that wants to insert or remove in it helps: they take chunks
+of JADWAL_LOCKFREE_CHUNK buckets, freeze them and copy the occupied ones, the thread that copies the last chunk
+publishes the next table, the others wait for that before they go on (lookups go on in the frozen table meanwhile)
+so only lookups are lock-free: while a table is being replaced every insert and remove waits in
+jadwal_lockfree_help_resize__() until the last copier has published the next one, a thread that is descheduled in the
+middle of copying a chunk holds them all up
+a replaced table is freed once no handle is in an operation that started before it was replaced (epoch based
+reclamation, a handle announces the epoch it saw in its own cache line, so lookups write to nothing shared)
+
+jadwal_hash() and jadwal_key_eq_cmp() are called from all threads at once, keys and values are written once, before
+their bucket is published, and never changed after that, so any plain data type works (it doesn't have to fit in a word)
+
+the api: jadwal_lockfree_init / init_with_udata / deinit / handle_init / handle_deinit / insert / remove / find / count,
+values are copied in and out, there are no iterators
+not available with JADWAL_GROUP_PROBE (no pair_data word), JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH (their inserts move
+other elements), JADWAL_INCREMENTAL (inserts and removes move elements between two tables) or JADWAL_STATS (lookups
+would write to the table)
+
+optional defines (compile time):
+    JADWAL_LOCKFREE_CHUNK     how many buckets a thread freezes and copies at a time while resizing (1024)
+*/
+
+#ifdef JADWAL_LOCKFREE_H
+#error "the header can only be safely included once"
+#endif // #ifdef JADWAL_LOCKFREE_H
+#define JADWAL_LOCKFREE_H
+
+#ifdef JADWAL_H
+#error "include jadwal_lockfree.h instead of jadwal.h"
+#endif
+#if defined(JADWAL_GROUP_PROBE) || defined(JADWAL_ROBIN_HOOD) || defined(JADWAL_HOPSCOTCH)
+#error "jadwal_lockfree.h can't be combined with JADWAL_GROUP_PROBE, JADWAL_ROBIN_HOOD or JADWAL_HOPSCOTCH"
+#endif
+#if defined(JADWAL_INCREMENTAL) || defined(JADWAL_STATS)
+#error "jadwal_lockfree.h can't be combined with JADWAL_INCREMENTAL or JADWAL_STATS"
+#endif
+#ifndef __GNUC__
+#error "jadwal_lockfree.h uses the __atomic builtins of gcc / clang"
+#endif
+
+#include "jadwal.h"
+#include <pthread.h>
+#include <sched.h> //sched_yield
+
+#ifndef JADWAL_LOCKFREE_CHUNK
+    #define JADWAL_LOCKFREE_CHUNK 1024
+#endif
+#if JADWAL_LOCKFREE_CHUNK < 1
+    #error "JADWAL_LOCKFREE_CHUNK must be at least 1"
+#endif
+
+//flags next to the ones of jadwal.h, a busy bucket has JADWAL_VLT_IS_NOT_EMPTY set too
+#define JADWAL_LOCKFREE_BUSY   (1U << 4)
+#define JADWAL_LOCKFREE_FROZEN (1U << 5)
+
+struct jadwal_lockfree_table {
+    struct jadwal ht; //only the buckets and the settings are used, the counts are the ones below
+    long nused; //buckets that aren't empty, counting the ones inserts have reserved but not claimed yet
+    long nelements;
+    long ndeleted;
+    long max_used; //an insert that would reserve more starts a resize, so probes always end at an empty bucket
+    struct jadwal_lockfree_table *next; //the table this one is being copied to
+    long nchunks;
+    long copy_idx; //the next chunk to copy
+    long ncopied;  //chunks done
+    struct jadwal_lockfree_table *retired_next;
+    unsigned long retired_epoch; //the value of epoch when it was replaced
+};
+
+//one per thread, registered with jadwal_lockfree_handle_init()
+struct jadwal_lockfree_handle {
+    unsigned long epoch; //0 outside an operation, only written by the thread that owns the handle
+    char pad[64]; //nothing else written to shares epoch's cache line
+    struct jadwal_lockfree *lf;
+    struct jadwal_lockfree_handle *next; //protected by lock
+};
+
+struct jadwal_lockfree {
+    struct jadwal_lockfree_table *current; //only replaced with an atomic store
+    unsigned long epoch; //starts at 1, bumped after every publish, only changed with lock held
+
+    //everything below is protected by lock, which is only taken to register handles and to publish a table
+    pthread_mutex_t lock;
+    struct jadwal_lockfree_handle *handles;
+    struct jadwal_lockfree_table *retired;
+    long nresizes; //how many tables were published
+};
+
+static unsigned int jadwal_lockfree_load__(struct jadwal_lockfree_table *t, long idx) {
+    return __atomic_load_n(jadwal_pair_data_at(&t->ht, idx), __ATOMIC_ACQUIRE);
+}
+static bool jadwal_lockfree_cas__(struct jadwal_lockfree_table *t, long idx, unsigned int *expected, unsigned int desired) {
+    return __atomic_compare_exchange_n(jadwal_pair_data_at(&t->ht, idx), expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static bool jadwal_lockfree_is_published__(unsigned int state) {
+    return (state & JADWAL_VLT_IS_NOT_EMPTY) && !(state & (JADWAL_LOCKFREE_BUSY | JADWAL_VLT_IS_DELETED));
+}
+//waits out an insert that claimed idx but hasn't published it yet, unless a resize froze it (it never will then)
+//only for the duplicate check of inserts and removes, lookups go past busy buckets
+static unsigned int jadwal_lockfree_wait_busy__(struct jadwal_lockfree_table *t, long idx, unsigned int state) {
+    while ((state & JADWAL_LOCKFREE_BUSY) && !(state & JADWAL_LOCKFREE_FROZEN)) {
+        sched_yield();
+        state = jadwal_lockfree_load__(t, idx);
+    }
+    return state;
+}
+
+//initial_nelements as for jadwal_init_copy_settings()
+static struct jadwal_lockfree_table *jadwal_lockfree_table_alloc__(const struct jadwal *settings_from, long initial_nelements) {
+    struct jadwal_lockfree_table *t = settings_from->memfuncs.alloc(sizeof *t, settings_from->userdata);
+    if (!t)
+        return NULL;
+    if (jadwal_init_copy_settings(&t->ht, initial_nelements, settings_from) != JADWAL_OK) {
+        settings_from->memfuncs.free(t, settings_from->userdata);
+        return NULL;
+    }
+    t->nused = 0;
+    t->nelements = 0;
+    t->ndeleted = 0;
+    t->max_used = t->ht.grow_at_gt_n < t->ht.nbuckets - 2 ? t->ht.grow_at_gt_n : t->ht.nbuckets - 2;
+    t->max_used = t->max_used < 1 ? 1 : t->max_used;
+    t->next = NULL;
+    t->nchunks = (t->ht.nbuckets + JADWAL_LOCKFREE_CHUNK - 1) / JADWAL_LOCKFREE_CHUNK;
+    t->copy_idx = 0;
+    t->ncopied = 0;
+    t->retired_next = NULL;
+    t->retired_epoch = 0;
+    return t;
+}
+static void jadwal_lockfree_table_free__(struct jadwal_lockfree_table *t) {
+    struct jadwal_alloc_funcs memfuncs = t->ht.memfuncs;
+    void *userdata = t->ht.userdata;
+    jadwal_deinit(&t->ht);
+    memfuncs.free(t, userdata);
+}
+
+//called with the lock held, frees the replaced tables no handle can be inside anymore
+//a handle in epoch e loaded current after epoch became e, so it's only inside tables replaced in e or later
+static void jadwal_lockfree_reclaim__(struct jadwal_lockfree *lf) {
+    unsigned long min_epoch = __atomic_load_n(&lf->epoch, __ATOMIC_RELAXED);
+    for (struct jadwal_lockfree_handle *h = lf->handles; h; h = h->next) {
+        unsigned long epoch = __atomic_load_n(&h->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < min_epoch)
+            min_epoch = epoch;
+    }
+    struct jadwal_lockfree_table **link = &lf->retired;
+    while (*link) {
+        struct jadwal_lockfree_table *t = *link;
+        if (t->retired_epoch < min_epoch) {
+            *link = t->retired_next;
+            jadwal_lockfree_table_free__(t);
+        }
+        else {
+            link = &t->retired_next;
+        }
+    }
+}
+
+//an operation begins by announcing the epoch and only then reading current
+static struct jadwal_lockfree_table *jadwal_lockfree_enter__(struct jadwal_lockfree_handle *h) {
+    struct jadwal_lockfree *lf = h->lf;
+    JADWAL_ASSERT(lf && h->epoch == 0, "the handle isn't registered, or is used by two threads");
+    __atomic_store_n(&h->epoch, __atomic_load_n(&lf->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&lf->current, __ATOMIC_SEQ_CST);
+}
+static void jadwal_lockfree_exit__(struct jadwal_lockfree_handle *h) {
+    __atomic_store_n(&h->epoch, 0, __ATOMIC_RELEASE);
+}
+
+//places an element that is being copied, next isn't visible to anyone but the other copiers, which only claim buckets
+static void jadwal_lockfree_place__(struct jadwal_lockfree_table *next, size_t full_hash, jadwal_key_type *key,
+                                    jadwal_value_type *value) {
+    unsigned int claimed = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY, jadwal_hash_to_partial_hash(full_hash));
+    long idx = jadwal_integer_mod_buckets(&next->ht, full_hash);
+    long step = jadwal_probe_step(&next->ht, full_hash);
+    for (long i = 0; ; i++) {
+        unsigned int expected = 0;
+        if (jadwal_lockfree_load__(next, idx) == 0 && jadwal_lockfree_cas__(next, idx, &expected, claimed))
+            break;
+        idx = jadwal_probe_next(&next->ht, idx, i, step);
+    }
+#ifdef JADWAL_STORE_HASH
+    *jadwal_hash_at(&next->ht, idx) = full_hash;
+#endif
+    memcpy(jadwal_key_at(&next->ht, idx), key, sizeof *key);
+    memcpy(jadwal_value_at(&next->ht, idx), value, sizeof *value);
+}
+
+//freezes the buckets of a chunk and copies the published ones, a bucket that was busy when frozen is left out, its
+//insert fails to publish it and goes again in the next table
+static void jadwal_lockfree_copy_chunk__(struct jadwal_lockfree_table *t, struct jadwal_lockfree_table *next, long chunk) {
+    long begin = chunk * JADWAL_LOCKFREE_CHUNK;
+    long end = begin + JADWAL_LOCKFREE_CHUNK < t->ht.nbuckets ? begin + JADWAL_LOCKFREE_CHUNK : t->ht.nbuckets;
+    long ncopied = 0;
+    for (long idx = begin; idx < end; idx++) {
+        unsigned int state = __atomic_fetch_or(jadwal_pair_data_at(&t->ht, idx), JADWAL_LOCKFREE_FROZEN, __ATOMIC_ACQ_REL);
+        if (!jadwal_lockfree_is_published__(state))
+            continue;
+        jadwal_lockfree_place__(next, jadwal_bucket_hash__(&t->ht, idx), jadwal_key_at(&t->ht, idx), jadwal_value_at(&t->ht, idx));
+        ncopied++;
+    }
+    __atomic_fetch_add(&next->nused, ncopied, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&next->nelements, ncopied, __ATOMIC_RELAXED);
+}
+
+static void jadwal_lockfree_publish__(struct jadwal_lockfree *lf, struct jadwal_lockfree_table *t,
+                                      struct jadwal_lockfree_table *next) {
+    __atomic_store_n(&lf->current, next, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&lf->lock);
+    t->retired_epoch = lf->epoch;
+    __atomic_store_n(&lf->epoch, lf->epoch + 1, __ATOMIC_SEQ_CST);
+    t->retired_next = lf->retired;
+    lf->retired = t;
+    lf->nresizes++;
+    jadwal_lockfree_reclaim__(lf);
+    pthread_mutex_unlock(&lf->lock);
+}
+
+//replaces t (starting that if no one has), helps copying it and returns once the next table is published
+static int jadwal_lockfree_help_resize__(struct jadwal_lockfree *lf, struct jadwal_lockfree_table *t) {
+    struct jadwal_lockfree_table *next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+    if (!next) {
+        //never more than max_used buckets are claimed and tombstones stay, so whatever is copied fits in max_used -
+        //ndeleted, that takes up about a third of the next table (less if it's read before the last removes)
+        long bound = t->max_used - __atomic_load_n(&t->ndeleted, __ATOMIC_RELAXED);
+        struct jadwal_lockfree_table *fresh = jadwal_lockfree_table_alloc__(&t->ht, bound + bound / 2);
+        if (!fresh)
+            return JADWAL_ALLOC_ERR;
+        if (__atomic_compare_exchange_n(&t->next, &next, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            next = fresh;
+        else
+            jadwal_lockfree_table_free__(fresh); //another thread was first, next is its table
+    }
+    long chunk;
+    while ((chunk = __atomic_fetch_add(&t->copy_idx, 1, __ATOMIC_RELAXED)) < t->nchunks) {
+        jadwal_lockfree_copy_chunk__(t, next, chunk);
+        if (__atomic_add_fetch(&t->ncopied, 1, __ATOMIC_ACQ_REL) == t->nchunks)
+            jadwal_lockfree_publish__(lf, t, next);
+    }
+    while (__atomic_load_n(&lf->current, __ATOMIC_ACQUIRE) == t)
+        sched_yield(); //the last chunks are still being copied (writers block here, see the top of the file)
+    return JADWAL_OK;
+}
+
+//returns JADWAL_OK, JADWAL_DUPLICATE_KEY, or JADWAL_RESIZE_REFUSE when t has to be replaced first
+static int jadwal_lockfree_insert_in__(struct jadwal_lockfree_table *t, jadwal_key_type *key, jadwal_value_type *value,
+                                       size_t full_hash) {
+    if (__atomic_load_n(&t->next, __ATOMIC_ACQUIRE))
+        return JADWAL_RESIZE_REFUSE;
+    if (__atomic_fetch_add(&t->nused, 1, __ATOMIC_RELAXED) >= t->max_used) {
+        __atomic_fetch_sub(&t->nused, 1, __ATOMIC_RELAXED);
+        return JADWAL_RESIZE_REFUSE;
+    }
+    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
+    unsigned int busy = jadwal_pair_combine_flags_and_partial_hash(JADWAL_VLT_IS_NOT_EMPTY | JADWAL_LOCKFREE_BUSY, partial_hash);
+    long idx = jadwal_integer_mod_buckets(&t->ht, full_hash);
+    long step = jadwal_probe_step(&t->ht, full_hash);
+    for (long i = 0; ; ) {
+        unsigned int state = jadwal_lockfree_load__(t, idx);
+        if (state == 0) {
+            if (!jadwal_lockfree_cas__(t, idx, &state, busy))
+                continue; //look at what got there first
+#ifdef JADWAL_STORE_HASH
+            *jadwal_hash_at(&t->ht, idx) = full_hash;
+#endif
+            memcpy(jadwal_key_at(&t->ht, idx), key, sizeof *key);
+            memcpy(jadwal_value_at(&t->ht, idx), value, sizeof *value);
+            unsigned int expected = busy;
+            if (!jadwal_lockfree_cas__(t, idx, &expected, busy & ~JADWAL_LOCKFREE_BUSY))
+                return JADWAL_RESIZE_REFUSE; //frozen before it was published, the copy left it out
+            __atomic_fetch_add(&t->nelements, 1, __ATOMIC_RELAXED);
+            return JADWAL_OK;
+        }
+        if (state & JADWAL_LOCKFREE_FROZEN)
+            return JADWAL_RESIZE_REFUSE;
+        if (jadwal_pair_get_partial_hash(&state) == partial_hash) {
+            if (state & JADWAL_LOCKFREE_BUSY) {
+                jadwal_lockfree_wait_busy__(t, idx, state);
+                continue;
+            }
+            if (!(state & JADWAL_VLT_IS_DELETED) && jadwal_key_cmp__(&t->ht, key, jadwal_key_at(&t->ht, idx)) == 0) {
+                __atomic_fetch_sub(&t->nused, 1, __ATOMIC_RELAXED);
+                return JADWAL_DUPLICATE_KEY;
+            }
+        }
+        idx = jadwal_probe_next(&t->ht, idx, i, step);
+        i++;
+    }
+}
+
+//returns JADWAL_OK, JADWAL_NOT_FOUND, or JADWAL_RESIZE_REFUSE when t is being replaced
+static int jadwal_lockfree_remove_in__(struct jadwal_lockfree_table *t, jadwal_key_type *key, size_t full_hash) {
+    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
+    long idx = jadwal_integer_mod_buckets(&t->ht, full_hash);
+    long step = jadwal_probe_step(&t->ht, full_hash);
+    for (long i = 0; ; ) {
+        unsigned int state = jadwal_lockfree_load__(t, idx);
+        if (state & JADWAL_LOCKFREE_FROZEN)
+            return JADWAL_RESIZE_REFUSE;
+        if (state == 0)
+            return JADWAL_NOT_FOUND;
+        if (jadwal_pair_get_partial_hash(&state) == partial_hash) {
+            if (state & JADWAL_LOCKFREE_BUSY) {
+                jadwal_lockfree_wait_busy__(t, idx, state);
+                continue;
+            }
+            if (!(state & JADWAL_VLT_IS_DELETED) && jadwal_key_cmp__(&t->ht, key, jadwal_key_at(&t->ht, idx)) == 0) {
+                if (!jadwal_lockfree_cas__(t, idx, &state, state | JADWAL_VLT_IS_DELETED))
+                    continue; //removed or frozen meanwhile
+                __atomic_fetch_sub(&t->nelements, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&t->ndeleted, 1, __ATOMIC_RELAXED);
+                return JADWAL_OK;
+            }
+        }
+        idx = jadwal_probe_next(&t->ht, idx, i, step);
+        i++;
+    }
+}
+
+//a frozen table is still complete, lookups don't wait for a resize, nor for a busy bucket: its insert hasn't
+//completed, so the lookup happens before it
+static int jadwal_lockfree_find_in__(struct jadwal_lockfree_table *t, jadwal_key_type *key, size_t full_hash,
+                                     jadwal_value_type *value_out) {
+    unsigned int partial_hash = jadwal_hash_to_partial_hash(full_hash);
+    long idx = jadwal_integer_mod_buckets(&t->ht, full_hash);
+    long step = jadwal_probe_step(&t->ht, full_hash);
+    for (long i = 0; ; i++) {
+        unsigned int state = jadwal_lockfree_load__(t, idx);
+        if (!(state & JADWAL_VLT_IS_NOT_EMPTY))
+            return JADWAL_NOT_FOUND;
+        if (jadwal_pair_get_partial_hash(&state) == partial_hash && jadwal_lockfree_is_published__(state) &&
+            jadwal_key_cmp__(&t->ht, key, jadwal_key_at(&t->ht, idx)) == 0) {
+            if (value_out)
+                memcpy(value_out, jadwal_value_at(&t->ht, idx), sizeof *value_out);
+            return JADWAL_OK;
+        }
+        idx = jadwal_probe_next(&t->ht, idx, i, step);
+    }
+}
+
+static int jadwal_lockfree_init_with_udata(struct jadwal_lockfree *lf, long initial_nelements, void *userdata) {
+    struct jadwal settings;
+    int rv = jadwal_init_ex(&settings, JADWAL_MIN_TABLESIZE, jadwal_def_malloc, jadwal_def_realloc, jadwal_def_free,
+                            userdata, JADWAL_DEFAULT_SHRINK_AT, JADWAL_DEFAULT_GROW_AT);
+    if (rv != JADWAL_OK)
+        return rv;
+    lf->current = jadwal_lockfree_table_alloc__(&settings, initial_nelements);
+    jadwal_deinit(&settings);
+    if (!lf->current)
+        return JADWAL_ALLOC_ERR;
+    lf->epoch = 1;
+    pthread_mutex_init(&lf->lock, NULL);
+    lf->handles = NULL;
+    lf->retired = NULL;
+    lf->nresizes = 0;
+    return JADWAL_OK;
+}
+static int jadwal_lockfree_init(struct jadwal_lockfree *lf, long initial_nelements) {
+    return jadwal_lockfree_init_with_udata(lf, initial_nelements, NULL);
+}
+
+//no other thread may be using the table anymore, the handles must have been deinitialized
+static void jadwal_lockfree_deinit(struct jadwal_lockfree *lf) {
+    JADWAL_ASSERT(!lf->handles, "a handle is still registered");
+    while (lf->retired) {
+        struct jadwal_lockfree_table *t = lf->retired;
+        lf->retired = t->retired_next;
+        jadwal_lockfree_table_free__(t);
+    }
+    jadwal_lockfree_table_free__(lf->current);
+    lf->current = NULL;
+    pthread_mutex_destroy(&lf->lock);
+}
+
+//registers h with lf, a handle is used by one thread at a time
+static void jadwal_lockfree_handle_init(struct jadwal_lockfree *lf, struct jadwal_lockfree_handle *h) {
+    h->epoch = 0;
+    h->lf = lf;
+    pthread_mutex_lock(&lf->lock);
+    h->next = lf->handles;
+    lf->handles = h;
+    pthread_mutex_unlock(&lf->lock);
+}
+
+//must not be in the middle of an operation
+static void jadwal_lockfree_handle_deinit(struct jadwal_lockfree_handle *h) {
+    struct jadwal_lockfree *lf = h->lf;
+    pthread_mutex_lock(&lf->lock);
+    struct jadwal_lockfree_handle **link = &lf->handles;
+    while (*link != h)
+        link = &(*link)->next;
+    *link = h->next;
+    jadwal_lockfree_reclaim__(lf);
+    pthread_mutex_unlock(&lf->lock);
+    h->lf = NULL;
+}
+
+//an approximation while other threads are changing the table
+static long jadwal_lockfree_count(struct jadwal_lockfree *lf) {
+    struct jadwal_lockfree_table *t = __atomic_load_n(&lf->current, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&t->nelements, __ATOMIC_RELAXED);
+}
+
+//returns JADWAL_OK or JADWAL_DUPLICATE_KEY (the value isn't replaced then), or JADWAL_ALLOC_ERR
+static int jadwal_lockfree_insert(struct jadwal_lockfree_handle *h, jadwal_key_type *key, jadwal_value_type *value) {
+    struct jadwal_lockfree_table *t = jadwal_lockfree_enter__(h);
+    size_t full_hash = jadwal_key_hash__(&t->ht, key);
+    int rv;
+    while ((rv = jadwal_lockfree_insert_in__(t, key, value, full_hash)) == JADWAL_RESIZE_REFUSE) {
+        rv = jadwal_lockfree_help_resize__(h->lf, t);
+        if (rv != JADWAL_OK)
+            break;
+        t = __atomic_load_n(&h->lf->current, __ATOMIC_SEQ_CST);
+    }
+    jadwal_lockfree_exit__(h);
+    return rv;
+}
+
+//returns JADWAL_OK or JADWAL_NOT_FOUND, or JADWAL_ALLOC_ERR
+static int jadwal_lockfree_remove(struct jadwal_lockfree_handle *h, jadwal_key_type *key) {
+    struct jadwal_lockfree_table *t = jadwal_lockfree_enter__(h);
+    size_t full_hash = jadwal_key_hash__(&t->ht, key);
+    int rv;
+    while ((rv = jadwal_lockfree_remove_in__(t, key, full_hash)) == JADWAL_RESIZE_REFUSE) {
+        rv = jadwal_lockfree_help_resize__(h->lf, t);
+        if (rv != JADWAL_OK)
+            break;
+        t = __atomic_load_n(&h->lf->current, __ATOMIC_SEQ_CST);
+    }
+    jadwal_lockfree_exit__(h);
+    return rv;
+}
+
+//never waits for a resize, copies the value to value_out (if it isn't NULL)
+//returns JADWAL_OK or JADWAL_NOT_FOUND
+static int jadwal_lockfree_find(struct jadwal_lockfree_handle *h, jadwal_key_type *key, jadwal_value_type *value_out) {
+    struct jadwal_lockfree_table *t = jadwal_lockfree_enter__(h);
+    int rv = jadwal_lockfree_find_in__(t, key, jadwal_key_hash__(&t->ht, key), value_out);
+    jadwal_lockfree_exit__(h);
+    return rv;
+}
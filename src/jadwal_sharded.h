@@ -0,0 +1,209 @@
+/*
+Copyright 2019 Turki Alsaleem
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+/*
+a wrapper that splits the keys over nshards independent struct jadwal tables, each behind its own mutex, so threads
+working on different shards never wait for each other and a resize only holds up the keys of one shard, link with
+-pthread
+
+the same things have to be defined before including this as for jadwal.h, jadwal.h is included from here (so it must
+not have been included before)
+
+the shard of a key comes from the top bits of jadwal_hash() multiplied by an odd constant, so that weak hashes (like
+the identity on small integers) spread over the shards too, and so that it doesn't pick the same bits JADWAL_POW2 takes
+the bucket from (which would leave most buckets of every shard unused)
+every shard is padded to its own cache lines, with its mutex next to its table
+
+the api: jadwal_sharded_init / init_with_udata / deinit / insert / remove / find / count / foreach, values are copied in
+and out, there are no iterators, jadwal_sharded_foreach() visits the shards one at a time with the shard locked
+*/
+
+#ifdef JADWAL_SHARDED_H
+#error "the header can only be safely included once"
+#endif // #ifdef JADWAL_SHARDED_H
+#define JADWAL_SHARDED_H
+
+#ifdef JADWAL_H
+#error "include jadwal_sharded.h instead of jadwal.h"
+#endif
+#ifndef __GNUC__
+#error "jadwal_sharded.h uses the aligned attribute of gcc / clang"
+#endif
+
+#include "jadwal.h"
+#include <pthread.h>
+
+#define JADWAL_SHARDED_ALIGN 64
+#define JADWAL_SHARDED_MAX_BITS 16
+
+struct jadwal_sharded_shard {
+    pthread_mutex_t lock;
+    struct jadwal ht;
+} __attribute__((aligned(JADWAL_SHARDED_ALIGN)));
+
+struct jadwal_sharded {
+    struct jadwal_sharded_shard *shards; //aligned to JADWAL_SHARDED_ALIGN within shards_mem
+    void *shards_mem;
+    long nshards;
+    int shard_bits; //nshards is 1 << shard_bits
+    void *userdata;
+};
+
+//must return nonzero to stop
+typedef int (*jadwal_sharded_visit_fptr)(jadwal_key_type *key, jadwal_value_type *value, void *arg);
+
+static struct jadwal_sharded_shard *jadwal_sharded_shard_of__(struct jadwal_sharded *s, size_t full_hash) {
+    if (s->shard_bits == 0)
+        return s->shards;
+    long idx = (long) (((uint64_t) full_hash * 0xD6E8FEB86659FD93ULL) >> (64 - s->shard_bits));
+    JADWAL_ASSERT(idx < s->nshards, "");
+    return s->shards + idx;
+}
+//the key is hashed once, the shard's table gets the hash through the _hashed functions
+static struct jadwal_sharded_shard *jadwal_sharded_lock_key__(struct jadwal_sharded *s, jadwal_key_type *key,
+                                                              size_t *full_hash_out) {
+#ifdef JADWAL_DATA_ARG
+    *full_hash_out = jadwal_hash(s->userdata, key);
+#else
+    *full_hash_out = jadwal_hash(key);
+#endif
+    struct jadwal_sharded_shard *shard = jadwal_sharded_shard_of__(s, *full_hash_out);
+    pthread_mutex_lock(&shard->lock);
+    return shard;
+}
+
+//nshards must be a power of two (up to 1 << JADWAL_SHARDED_MAX_BITS), initial_nelements is split between the shards
+static int jadwal_sharded_init_with_udata(struct jadwal_sharded *s, long nshards, long initial_nelements, void *userdata) {
+    int shard_bits = 0;
+    while ((1L << shard_bits) < nshards && shard_bits < JADWAL_SHARDED_MAX_BITS)
+        shard_bits++;
+    if (nshards < 1 || (1L << shard_bits) != nshards)
+        return JADWAL_INVALID_REQ_SZ;
+    void *mem = jadwal_def_malloc(nshards * sizeof(struct jadwal_sharded_shard) + JADWAL_SHARDED_ALIGN, userdata);
+    if (!mem)
+        return JADWAL_ALLOC_ERR;
+    uintptr_t aligned = ((uintptr_t) mem + JADWAL_SHARDED_ALIGN - 1) & ~(uintptr_t) (JADWAL_SHARDED_ALIGN - 1);
+    s->shards = (struct jadwal_sharded_shard *) aligned;
+    s->shards_mem = mem;
+    s->nshards = nshards;
+    s->shard_bits = shard_bits;
+    s->userdata = userdata;
+    for (long i = 0; i < nshards; i++) {
+        int rv = jadwal_init_with_udata(&s->shards[i].ht, initial_nelements / nshards, userdata);
+        if (rv != JADWAL_OK) {
+            while (i-- > 0) {
+                jadwal_deinit(&s->shards[i].ht);
+                pthread_mutex_destroy(&s->shards[i].lock);
+            }
+            jadwal_def_free(mem, userdata);
+            return rv;
+        }
+        pthread_mutex_init(&s->shards[i].lock, NULL);
+    }
+    return JADWAL_OK;
+}
+static int jadwal_sharded_init(struct jadwal_sharded *s, long nshards, long initial_nelements) {
+    return jadwal_sharded_init_with_udata(s, nshards, initial_nelements, NULL);
+}
+
+//no other thread may be using the table anymore
+static void jadwal_sharded_deinit(struct jadwal_sharded *s) {
+    for (long i = 0; i < s->nshards; i++) {
+        jadwal_deinit(&s->shards[i].ht);
+        pthread_mutex_destroy(&s->shards[i].lock);
+    }
+    jadwal_def_free(s->shards_mem, s->userdata);
+    s->shards = NULL;
+    s->shards_mem = NULL;
+}
+
+//returns what jadwal_insert() returns
+static int jadwal_sharded_insert(struct jadwal_sharded *s, jadwal_key_type *key, jadwal_value_type *value) {
+    size_t full_hash;
+    struct jadwal_sharded_shard *shard = jadwal_sharded_lock_key__(s, key, &full_hash);
+    int rv = jadwal_insert_hashed(&shard->ht, key, value, full_hash);
+    pthread_mutex_unlock(&shard->lock);
+    return rv;
+}
+
+static int jadwal_sharded_remove(struct jadwal_sharded *s, jadwal_key_type *key) {
+    size_t full_hash;
+    struct jadwal_sharded_shard *shard = jadwal_sharded_lock_key__(s, key, &full_hash);
+    int rv = jadwal_remove_hashed(&shard->ht, key, full_hash);
+    pthread_mutex_unlock(&shard->lock);
+    return rv;
+}
+
+//copies the value to value_out (if it isn't NULL), returns JADWAL_OK or JADWAL_NOT_FOUND
+static int jadwal_sharded_find(struct jadwal_sharded *s, jadwal_key_type *key, jadwal_value_type *value_out) {
+    size_t full_hash;
+    struct jadwal_sharded_shard *shard = jadwal_sharded_lock_key__(s, key, &full_hash);
+    struct jadwal_iter iter;
+    int rv = jadwal_find_hashed(&shard->ht, key, full_hash, &iter);
+    if (rv == JADWAL_OK && value_out)
+        memcpy(value_out, jadwal_iter_value(&iter), sizeof *value_out);
+    pthread_mutex_unlock(&shard->lock);
+    return rv;
+}
+
+//the sum of the shard counts, each one is taken with its shard locked, but the shards aren't locked all at once
+static long jadwal_sharded_count(struct jadwal_sharded *s) {
+    long count = 0;
+    for (long i = 0; i < s->nshards; i++) {
+        pthread_mutex_lock(&s->shards[i].lock);
+        count += jadwal_count(&s->shards[i].ht);
+        pthread_mutex_unlock(&s->shards[i].lock);
+    }
+    return count;
+}
+
+//calls visit on every element, shard by shard with the shard locked (visit can change the value, but must not call
+//into s), returns JADWAL_OK, or what visit returned if it stopped, or an error
+static int jadwal_sharded_foreach(struct jadwal_sharded *s, jadwal_sharded_visit_fptr visit, void *arg) {
+    for (long i = 0; i < s->nshards; i++) {
+        struct jadwal_sharded_shard *shard = s->shards + i;
+        pthread_mutex_lock(&shard->lock);
+        struct jadwal_iter iter;
+        int rv = jadwal_begin_iterator(&shard->ht, &iter);
+        for (; rv == JADWAL_OK; rv = jadwal_iter_next(&shard->ht, &iter)) {
+            int stop = visit(jadwal_iter_key(&iter), jadwal_iter_value(&iter), arg);
+            if (stop) {
+                pthread_mutex_unlock(&shard->lock);
+                return stop;
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+        if (rv != JADWAL_ITER_STOP)
+            return rv;
+    }
+    return JADWAL_OK;
+}
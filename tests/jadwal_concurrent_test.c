@@ -0,0 +1,362 @@
+//must define this in build system, otherwise the tests are useless #define JADWAL_DBG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+typedef int jadwal_key_type; 
+typedef int jadwal_value_type; 
+
+//unlike tests/jadwal_test.c the hash isn't the identity, sequential keys with removals in between would make runs of
+//tombstones as long as the table with linear probing, and every miss would walk them
+
+#ifdef JADWAL_DATA_ARG
+int mydata[] = {213123,2313123,664536,3423424,31231231};
+void assert_udata_is_ok(void *udata) {
+    for (int i=0;  i < (int)(sizeof mydata / sizeof mydata[0]); i++) {
+        int *data = (int *) udata;
+        assert(data[i] == mydata[i]);
+    }
+}
+size_t jadwal_hash(void *udata, jadwal_key_type *key) {
+    assert_udata_is_ok(udata);
+    return (size_t) *key * 2654435761u;
+}
+
+bool jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    assert_udata_is_ok(udata);
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA mydata
+#else
+size_t jadwal_hash(jadwal_key_type *key) {
+    return (size_t) *key * 2654435761u;
+}
+
+bool jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA NULL
+#endif
+#include "../src/jadwal_concurrent.h"
+
+static unsigned long test_rand_r(unsigned long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void test_basic(void) {
+    struct jadwal_concurrent c;
+    int rv = jadwal_concurrent_init_with_udata(&c, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<20000; i++) {
+        int value = i * 3;
+        rv = jadwal_concurrent_insert(&c, &i, &value);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_concurrent_insert(&c, &i, &value);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+    }
+    //finds don't wait for a build in progress
+    for (int i=0; i<40000; i++) {
+        int value = -1;
+        rv = jadwal_concurrent_find(&c, &i, &value);
+        assert(rv == (i < 20000 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(value == (i < 20000 ? i * 3 : -1));
+    }
+    for (int i=0; i<20000; i+=2) {
+        rv = jadwal_concurrent_remove(&c, &i);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_concurrent_remove(&c, &i);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    jadwal_concurrent_wait(&c);
+    assert(!c.building && c.nbuilds > 0);
+    assert(jadwal_concurrent_count(&c) == 10000);
+    for (int i=0; i<20000; i++) {
+        rv = jadwal_concurrent_find(&c, &i, NULL);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_concurrent_deinit(&c);
+}
+
+//random inserts and removes checked against an array, the builds replay a log with both
+void test_churn(void) {
+    enum { NKEYS = 5000, NOPS = 200000 };
+    static int expected[NKEYS]; //value + 1, 0 when absent
+    memset(expected, 0, sizeof expected);
+    struct jadwal_concurrent c;
+    int rv = jadwal_concurrent_init_with_udata(&c, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    unsigned long state = 88172645463325252UL;
+    for (int op=0; op<NOPS; op++) {
+        int key = test_rand_r(&state) % NKEYS;
+        int value = op;
+        if (test_rand_r(&state) % 3) {
+            rv = jadwal_concurrent_insert(&c, &key, &value);
+            assert(rv == (expected[key] ? JADWAL_DUPLICATE_KEY : JADWAL_OK));
+            if (!expected[key])
+                expected[key] = value + 1;
+        }
+        else {
+            rv = jadwal_concurrent_remove(&c, &key);
+            assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            expected[key] = 0;
+        }
+        if (op % 1000 == 0) {
+            int found = -1;
+            rv = jadwal_concurrent_find(&c, &key, &found);
+            assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            assert(!expected[key] || found == expected[key] - 1);
+        }
+    }
+    jadwal_concurrent_wait(&c);
+    long count = 0;
+    for (int key=0; key<NKEYS; key++) {
+        int found = -1;
+        rv = jadwal_concurrent_find(&c, &key, &found);
+        assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(!expected[key] || found == expected[key] - 1);
+        count += expected[key] != 0;
+    }
+    assert(jadwal_concurrent_count(&c) == count);
+    jadwal_concurrent_deinit(&c);
+}
+
+//readers look up keys the writer already inserted while the writer grows the table several times
+#define NREADERS 3
+#define NKEYS_READERS 200000
+struct test_readers_shared {
+    struct jadwal_concurrent c;
+    struct jadwal_concurrent_reader readers[NREADERS]; //the odd ones look up through a registered reader
+    int inserted; //keys below this are in the table (except multiples of 7, which are removed right away)
+    int done;
+};
+struct test_reader_arg {
+    struct test_readers_shared *shared;
+    struct jadwal_concurrent_reader *reader; //NULL for jadwal_concurrent_find()
+};
+static int test_reader_find(struct test_reader_arg *arg, int *key, int *value) {
+    if (arg->reader)
+        return jadwal_concurrent_reader_find(arg->reader, key, value);
+    return jadwal_concurrent_find(&arg->shared->c, key, value);
+}
+static void *test_reader_main(void *arg_) {
+    struct test_reader_arg *arg = arg_;
+    struct test_readers_shared *shared = arg->shared;
+    unsigned long state = 0x9E3779B97F4A7C15UL ^ (unsigned long) pthread_self();
+    long nfinds = 0;
+    while (!__atomic_load_n(&shared->done, __ATOMIC_ACQUIRE)) {
+        int inserted = __atomic_load_n(&shared->inserted, __ATOMIC_ACQUIRE);
+        if (inserted == 0)
+            continue;
+        int key = test_rand_r(&state) % inserted;
+        int value = -1;
+        int rv = test_reader_find(arg, &key, &value);
+        if (key % 7 != 0)
+            assert(rv == JADWAL_OK && value == key * 3);
+        else
+            assert((rv == JADWAL_OK && value == key * 3) || rv == JADWAL_NOT_FOUND);
+        key = -1 - key;
+        rv = test_reader_find(arg, &key, NULL);
+        assert(rv == JADWAL_NOT_FOUND);
+        nfinds++;
+    }
+    return (void *) nfinds;
+}
+void test_readers(void) {
+    static struct test_readers_shared shared;
+    int rv = jadwal_concurrent_init_with_udata(&shared.c, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    shared.inserted = 0;
+    shared.done = 0;
+    pthread_t readers[NREADERS];
+    struct test_reader_arg args[NREADERS];
+    for (int i=0; i<NREADERS; i++) {
+        args[i].shared = &shared;
+        args[i].reader = NULL;
+        if (i % 2) {
+            args[i].reader = &shared.readers[i];
+            jadwal_concurrent_reader_init(&shared.c, args[i].reader);
+        }
+        rv = pthread_create(&readers[i], NULL, test_reader_main, &args[i]);
+        assert(rv == 0);
+    }
+    for (int i=0; i<NKEYS_READERS; i++) {
+        int value = i * 3;
+        rv = jadwal_concurrent_insert(&shared.c, &i, &value);
+        assert(rv == JADWAL_OK);
+        if (i % 7 == 0) {
+            rv = jadwal_concurrent_remove(&shared.c, &i);
+            assert(rv == JADWAL_OK);
+        }
+        __atomic_store_n(&shared.inserted, i + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&shared.done, 1, __ATOMIC_RELEASE);
+    long nfinds = 0;
+    for (int i=0; i<NREADERS; i++) {
+        void *reader_nfinds;
+        pthread_join(readers[i], &reader_nfinds);
+        nfinds += (long) reader_nfinds;
+        if (args[i].reader)
+            jadwal_concurrent_reader_deinit(args[i].reader);
+    }
+    assert(nfinds > 0);
+    jadwal_concurrent_wait(&shared.c);
+    assert(shared.c.nbuilds >= 3);
+    for (int i=0; i<NKEYS_READERS; i++) {
+        int value = -1;
+        rv = jadwal_concurrent_find(&shared.c, &i, &value);
+        assert(rv == (i % 7 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(i % 7 == 0 || value == i * 3);
+    }
+    assert(jadwal_concurrent_count(&shared.c) == NKEYS_READERS - (NKEYS_READERS + 6) / 7);
+    jadwal_concurrent_deinit(&shared.c);
+}
+
+//readers keep looking up the odd keys while the writer removes the even ones, enough for the tombstones to go over
+//purge_at_gt_n, the purge is a build like growing is: the live table is never rehashed in place, so the readers
+//aren't held up by it
+#define NKEYS_PURGE 60000
+//sequential keys land on a lattice with the multiplicative hash and never next to each other, so removing them leaves
+//no tombstones, key i is a bijective mix of i instead
+static int test_purge_key(int i) {
+    unsigned x = (unsigned) i;
+    x = ((x >> 16) ^ x) * 0x45d9f3bu;
+    x = ((x >> 16) ^ x) * 0x45d9f3bu;
+    x = (x >> 16) ^ x;
+    return (int) (x & 0x7fffffff);
+}
+struct test_purge_shared {
+    struct jadwal_concurrent c;
+    long nfinds[NREADERS];
+    int done;
+};
+struct test_purge_arg {
+    struct test_purge_shared *shared;
+    int idx;
+};
+static void *test_purge_reader_main(void *arg_) {
+    struct test_purge_arg *arg = arg_;
+    struct test_purge_shared *shared = arg->shared;
+    unsigned long state = 0x2545F4914F6CDD1DUL + arg->idx;
+    while (!__atomic_load_n(&shared->done, __ATOMIC_ACQUIRE)) {
+        int i = (test_rand_r(&state) % (NKEYS_PURGE / 2)) * 2 + 1;
+        int key = test_purge_key(i);
+        int value = -1;
+        int rv = jadwal_concurrent_find(&shared->c, &key, &value);
+        assert(rv == JADWAL_OK && value == i * 3);
+        __atomic_fetch_add(&shared->nfinds[arg->idx], 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+void test_purge_readers(void) {
+    static struct test_purge_shared shared;
+    int rv = jadwal_concurrent_init_with_udata(&shared.c, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<NKEYS_PURGE; i++) {
+        int key = test_purge_key(i);
+        int value = i * 3;
+        rv = jadwal_concurrent_insert(&shared.c, &key, &value);
+        assert(rv == JADWAL_OK);
+    }
+    jadwal_concurrent_wait(&shared.c);
+    //the table is far from full, a low threshold makes the removals below cross it several times (builds copy it)
+    jadwal_set_purge_at(&shared.c.current->ht, 1);
+    shared.done = 0;
+    pthread_t readers[NREADERS];
+    struct test_purge_arg args[NREADERS];
+    for (int i=0; i<NREADERS; i++) {
+        shared.nfinds[i] = 0;
+        args[i].shared = &shared;
+        args[i].idx = i;
+        rv = pthread_create(&readers[i], NULL, test_purge_reader_main, &args[i]);
+        assert(rv == 0);
+    }
+    long nbuilds = shared.c.nbuilds;
+    long nbuckets = shared.c.current->ht.nbuckets;
+    long purge_at = shared.c.current->ht.purge_at_gt_n;
+    long max_ndeleted = 0;
+    for (int i=0; i<NKEYS_PURGE; i+=2) {
+        int key = test_purge_key(i);
+        rv = jadwal_concurrent_remove(&shared.c, &key);
+        assert(rv == JADWAL_OK);
+        //only this thread writes, so the live table can be looked at between the calls
+        if (shared.c.current->ht.ndeleted > max_ndeleted)
+            max_ndeleted = shared.c.current->ht.ndeleted;
+    }
+    jadwal_concurrent_wait(&shared.c);
+    //the readers went on looking up, wait until each of them did some more after the purges
+    long nfinds_after[NREADERS];
+    for (int i=0; i<NREADERS; i++)
+        nfinds_after[i] = __atomic_load_n(&shared.nfinds[i], __ATOMIC_RELAXED);
+    for (int i=0; i<NREADERS; i++) {
+        while (__atomic_load_n(&shared.nfinds[i], __ATOMIC_RELAXED) < nfinds_after[i] + 100)
+            sched_yield();
+    }
+    __atomic_store_n(&shared.done, 1, __ATOMIC_RELEASE);
+    for (int i=0; i<NREADERS; i++)
+        pthread_join(readers[i], NULL);
+    assert(max_ndeleted > purge_at && shared.c.nbuilds > nbuilds && shared.c.npurges_in_place == 0);
+    assert(shared.c.current->ht.nbuckets <= nbuckets);
+    for (int i=0; i<NKEYS_PURGE; i++) {
+        int key = test_purge_key(i);
+        int value = -1;
+        rv = jadwal_concurrent_find(&shared.c, &key, &value);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(i % 2 == 0 || value == i * 3);
+    }
+    assert(jadwal_concurrent_count(&shared.c) == NKEYS_PURGE / 2);
+    jadwal_concurrent_deinit(&shared.c);
+}
+
+//a retired table stays around while a registered reader is in an epoch it could have seen it in
+void test_reader_epochs(void) {
+    struct jadwal_concurrent c;
+    int rv = jadwal_concurrent_init_with_udata(&c, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    struct jadwal_concurrent_reader r1;
+    struct jadwal_concurrent_reader r2;
+    jadwal_concurrent_reader_init(&c, &r1);
+    jadwal_concurrent_reader_init(&c, &r2);
+    int key = 0;
+    int value = 0;
+    rv = jadwal_concurrent_insert(&c, &key, &value);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_concurrent_reader_find(&r1, &key, &value);
+    assert(rv == JADWAL_OK && value == 0 && r1.epoch == 0);
+
+    r1.epoch = c.epoch; //as if r1 were in the middle of a lookup
+    unsigned long r1_epoch = r1.epoch;
+    long nbuilds = c.nbuilds;
+    for (key=1; c.nbuilds == nbuilds; key++) {
+        rv = jadwal_concurrent_insert(&c, &key, &key);
+        assert(rv == JADWAL_OK);
+        jadwal_concurrent_wait(&c);
+    }
+    assert(c.epoch > r1_epoch && c.retired && c.retired->retired_epoch == r1_epoch);
+    rv = jadwal_concurrent_reader_find(&r2, &key, NULL); //r2 is in a later epoch, it doesn't hold anything back
+    assert(rv == JADWAL_NOT_FOUND);
+    rv = jadwal_concurrent_insert(&c, &key, &key);
+    assert(rv == JADWAL_OK && c.retired);
+    r1.epoch = 0;
+    key++;
+    rv = jadwal_concurrent_insert(&c, &key, &key); //writes reclaim
+    assert(rv == JADWAL_OK && !c.retired);
+
+    jadwal_concurrent_reader_deinit(&r1);
+    jadwal_concurrent_reader_deinit(&r2);
+    assert(!c.readers);
+    jadwal_concurrent_deinit(&c);
+}
+
+int main(void) {
+    test_basic();
+    test_churn();
+    test_readers();
+    test_purge_readers();
+    test_reader_epochs();
+    printf("success\n");
+}
@@ -0,0 +1,186 @@
+//must define this in build system, otherwise the tests are useless #define JADWAL_DBG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+typedef int jadwal_key_type; 
+typedef int jadwal_value_type; 
+
+#ifdef JADWAL_DATA_ARG
+int mydata[] = {213123,2313123,664536,3423424,31231231};
+void assert_udata_is_ok(void *udata) {
+    for (int i=0;  i < (int)(sizeof mydata / sizeof mydata[0]); i++) {
+        int *data = (int *) udata;
+        assert(data[i] == mydata[i]);
+    }
+}
+size_t jadwal_hash(void *udata, jadwal_key_type *key) {
+    assert_udata_is_ok(udata);
+    return *key;
+}
+
+bool jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    assert_udata_is_ok(udata);
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA mydata
+#else
+size_t jadwal_hash(jadwal_key_type *key) {
+    return *key;
+}
+
+bool jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA NULL
+#endif
+#include "../src/jadwal_cuckoo.h"
+
+static unsigned long test_rand_state = 88172645463325252UL;
+static unsigned long test_rand(void) {
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 7;
+    test_rand_state ^= test_rand_state << 17;
+    return test_rand_state;
+}
+
+//every element must be in one of its two buckets and the count must match
+void test_check_placement(struct jadwal_cuckoo *ht) {
+    long count = 0;
+    for (long b=0; b<ht->nbuckets; b++) {
+        struct jadwal_cuckoo_bucket *bucket = jadwal_cuckoo_bucket_at(ht, b);
+        assert(((uintptr_t) bucket % JADWAL_CUCKOO_LINE) == 0);
+        for (int i=0; i<JADWAL_CUCKOO_SLOTS; i++) {
+            if (bucket->tags[i] == JADWAL_CUCKOO_TAG_EMPTY)
+                continue;
+            count++;
+            uint64_t mixed = jadwal_cuckoo_mix(jadwal_cuckoo_hash__(ht, &bucket->keys[i]));
+            long b1 = jadwal_cuckoo_first_bucket(ht, mixed);
+            assert(bucket->tags[i] == jadwal_cuckoo_tag(mixed));
+            assert(b == b1 || b == jadwal_cuckoo_alt_bucket(ht, b1, bucket->tags[i]));
+        }
+    }
+    assert(count == ht->nelements);
+}
+
+void test_iter_expect_count(struct jadwal_cuckoo *ht, long expected_len) {
+    struct jadwal_cuckoo_iter iter;
+    long count = 0;
+    for (int rv = jadwal_cuckoo_begin_iterator(ht, &iter); rv == JADWAL_OK; rv = jadwal_cuckoo_iter_next(ht, &iter)) {
+        assert(jadwal_cuckoo_iter_check(&iter));
+        count++;
+    }
+    assert(!jadwal_cuckoo_iter_check(&iter));
+    assert(count == expected_len);
+}
+
+void test_basic(void) {
+    struct jadwal_cuckoo ht;
+    int rv = jadwal_cuckoo_init_with_udata(&ht, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    test_iter_expect_count(&ht, 0);
+    for (int i=0; i<1000; i++) {
+        int value = i * 3;
+        rv = jadwal_cuckoo_insert(&ht, &i, &value);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_cuckoo_insert(&ht, &i, &value);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+    }
+    test_check_placement(&ht);
+    test_iter_expect_count(&ht, 1000);
+    for (int i=0; i<2000; i++) {
+        struct jadwal_cuckoo_iter iter;
+        rv = jadwal_cuckoo_find(&ht, &i, &iter);
+        assert(rv == (i < 1000 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(jadwal_cuckoo_iter_check(&iter) == (i < 1000));
+        if (i < 1000)
+            assert(*jadwal_cuckoo_iter_key(&iter) == i && *jadwal_cuckoo_iter_value(&iter) == i * 3);
+    }
+    //find_or_insert overwrites like jadwal_find_or_insert()
+    int key = 5, value = -5;
+    struct jadwal_cuckoo_iter iter;
+    rv = jadwal_cuckoo_find_or_insert(&ht, &key, &value, &iter);
+    assert(rv == JADWAL_OK && *jadwal_cuckoo_iter_value(&iter) == -5);
+    key = 5000;
+    rv = jadwal_cuckoo_find_or_insert(&ht, &key, &value, &iter);
+    assert(rv == JADWAL_OK && *jadwal_cuckoo_iter_key(&iter) == 5000);
+    rv = jadwal_cuckoo_remove(&ht, &key);
+    assert(rv == JADWAL_OK);
+
+    //removing while iterating
+    for (rv = jadwal_cuckoo_begin_iterator(&ht, &iter); rv == JADWAL_OK; rv = jadwal_cuckoo_iter_next(&ht, &iter)) {
+        if (*jadwal_cuckoo_iter_key(&iter) % 2 == 0) {
+            int k = *jadwal_cuckoo_iter_key(&iter);
+            assert(jadwal_cuckoo_remove(&ht, &k) == JADWAL_OK);
+        }
+    }
+    test_iter_expect_count(&ht, 500);
+    for (int i=0; i<1000; i++) {
+        rv = jadwal_cuckoo_remove(&ht, &i);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    test_iter_expect_count(&ht, 0);
+    jadwal_cuckoo_deinit(&ht);
+}
+
+//random inserts / removes / finds checked against a plain array, a high insert ratio keeps the buckets full so
+//insertions go through the eviction search and the growth path
+#define RANDOM_OPS_NKEYS 20000
+#define RANDOM_OPS_NOPS  200000
+void test_random_ops(void) {
+    static bool present[RANDOM_OPS_NKEYS];
+    static int  expected_value[RANDOM_OPS_NKEYS];
+    memset(present, 0, sizeof present);
+    long count = 0;
+
+    struct jadwal_cuckoo ht;
+    int rv = jadwal_cuckoo_init_with_udata(&ht, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+
+    for (int i=0; i<RANDOM_OPS_NOPS; i++) {
+        //strided keys, only the high bits differ
+        int key_idx = test_rand() % RANDOM_OPS_NKEYS;
+        int key = key_idx << 10;
+        int value = test_rand() % 100000;
+        int op = test_rand() % 8;
+        if (op < 2) {
+            rv = jadwal_cuckoo_remove(&ht, &key);
+            assert(rv == (present[key_idx] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            if (present[key_idx])
+                count--;
+            present[key_idx] = false;
+        }
+        else if (op < 6) {
+            rv = jadwal_cuckoo_insert(&ht, &key, &value);
+            assert(rv == (present[key_idx] ? JADWAL_DUPLICATE_KEY : JADWAL_OK));
+            if (!present[key_idx]) {
+                count++;
+                expected_value[key_idx] = value;
+            }
+            present[key_idx] = true;
+        }
+        else {
+            struct jadwal_cuckoo_iter iter;
+            rv = jadwal_cuckoo_find(&ht, &key, &iter);
+            assert(rv == (present[key_idx] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            if (present[key_idx])
+                assert(*jadwal_cuckoo_iter_value(&iter) == expected_value[key_idx]);
+        }
+        if (i % 20000 == 0) {
+            test_check_placement(&ht);
+            test_iter_expect_count(&ht, count);
+        }
+    }
+    test_check_placement(&ht);
+    test_iter_expect_count(&ht, count);
+    //growth only happens when an insertion can't find room, so the table can't have grown far past what it holds
+    assert(ht.nelements * 4 > ht.nbuckets * JADWAL_CUCKOO_SLOTS);
+    jadwal_cuckoo_deinit(&ht);
+}
+
+int main(void) {
+    test_basic();
+    test_random_ops();
+    printf("success\n");
+}
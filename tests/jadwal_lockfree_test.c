@@ -0,0 +1,256 @@
+//must define this in build system, otherwise the tests are useless #define JADWAL_DBG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+typedef int jadwal_key_type; 
+typedef int jadwal_value_type; 
+
+//like tests/jadwal_concurrent_test.c the hash isn't the identity, runs of tombstones would get as long as the table
+
+#ifdef JADWAL_DATA_ARG
+int mydata[] = {213123,2313123,664536,3423424,31231231};
+void assert_udata_is_ok(void *udata) {
+    for (int i=0;  i < (int)(sizeof mydata / sizeof mydata[0]); i++) {
+        int *data = (int *) udata;
+        assert(data[i] == mydata[i]);
+    }
+}
+size_t jadwal_hash(void *udata, jadwal_key_type *key) {
+    assert_udata_is_ok(udata);
+    return (size_t) *key * 2654435761u;
+}
+
+bool jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    assert_udata_is_ok(udata);
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA mydata
+#else
+size_t jadwal_hash(jadwal_key_type *key) {
+    return (size_t) *key * 2654435761u;
+}
+
+bool jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA NULL
+#endif
+#include "../src/jadwal_lockfree.h"
+
+static unsigned long test_rand_r(unsigned long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void test_basic(void) {
+    struct jadwal_lockfree lf;
+    int rv = jadwal_lockfree_init_with_udata(&lf, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    struct jadwal_lockfree_handle h;
+    jadwal_lockfree_handle_init(&lf, &h);
+    for (int i=0; i<20000; i++) {
+        int value = i * 3;
+        rv = jadwal_lockfree_insert(&h, &i, &value);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_lockfree_insert(&h, &i, &value);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+    }
+    assert(lf.nresizes > 0 && jadwal_lockfree_count(&lf) == 20000);
+    for (int i=0; i<40000; i++) {
+        int value = -1;
+        rv = jadwal_lockfree_find(&h, &i, &value);
+        assert(rv == (i < 20000 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(value == (i < 20000 ? i * 3 : -1));
+    }
+    for (int i=0; i<20000; i+=2) {
+        rv = jadwal_lockfree_remove(&h, &i);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_lockfree_remove(&h, &i);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    assert(jadwal_lockfree_count(&lf) == 10000);
+    for (int i=0; i<20000; i++) {
+        rv = jadwal_lockfree_find(&h, &i, NULL);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    //the table a resize replaces can't be freed while the thread that published the next one is still in its insert,
+    //later publishes and deinitializing handles free it
+    jadwal_lockfree_handle_deinit(&h);
+    assert(!lf.retired);
+    jadwal_lockfree_deinit(&lf);
+}
+
+//a bucket whose insert hasn't published it yet (made busy by hand here) is gone past by lookups, they don't wait for it
+void test_busy(void) {
+    struct jadwal_lockfree lf;
+    int rv = jadwal_lockfree_init_with_udata(&lf, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    struct jadwal_lockfree_handle h;
+    jadwal_lockfree_handle_init(&lf, &h);
+    for (int i=0; i<100; i++) {
+        int value = i * 3;
+        rv = jadwal_lockfree_insert(&h, &i, &value);
+        assert(rv == JADWAL_OK);
+    }
+    struct jadwal_lockfree_table *t = lf.current;
+    int key = 42;
+    long idx = 0;
+    while (!jadwal_lockfree_is_published__(jadwal_lockfree_load__(t, idx)) || *jadwal_key_at(&t->ht, idx) != key)
+        idx++;
+    __atomic_fetch_or(jadwal_pair_data_at(&t->ht, idx), JADWAL_LOCKFREE_BUSY, __ATOMIC_ACQ_REL);
+    int value = -1;
+    rv = jadwal_lockfree_find(&h, &key, &value);
+    assert(rv == JADWAL_NOT_FOUND && value == -1);
+    for (int i=0; i<100; i++) {
+        rv = jadwal_lockfree_find(&h, &i, NULL);
+        assert(rv == (i == key ? JADWAL_NOT_FOUND : JADWAL_OK));
+    }
+    __atomic_fetch_and(jadwal_pair_data_at(&t->ht, idx), ~JADWAL_LOCKFREE_BUSY, __ATOMIC_ACQ_REL);
+    rv = jadwal_lockfree_find(&h, &key, &value);
+    assert(rv == JADWAL_OK && value == key * 3);
+    jadwal_lockfree_handle_deinit(&h);
+    jadwal_lockfree_deinit(&lf);
+}
+
+//random inserts and removes checked against an array, the tombstones they leave make the table rehash at the same
+//size or smaller, not only grow
+void test_churn(void) {
+    enum { NKEYS = 5000, NOPS = 200000 };
+    static int expected[NKEYS]; //value + 1, 0 when absent
+    memset(expected, 0, sizeof expected);
+    struct jadwal_lockfree lf;
+    int rv = jadwal_lockfree_init_with_udata(&lf, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    struct jadwal_lockfree_handle h;
+    jadwal_lockfree_handle_init(&lf, &h);
+    unsigned long state = 88172645463325252UL;
+    long max_nbuckets = 0;
+    for (int op=0; op<NOPS; op++) {
+        int key = test_rand_r(&state) % NKEYS;
+        int value = op;
+        if (test_rand_r(&state) % 2) {
+            rv = jadwal_lockfree_insert(&h, &key, &value);
+            assert(rv == (expected[key] ? JADWAL_DUPLICATE_KEY : JADWAL_OK));
+            if (!expected[key])
+                expected[key] = value + 1;
+        }
+        else {
+            rv = jadwal_lockfree_remove(&h, &key);
+            assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            expected[key] = 0;
+        }
+        if (lf.current->ht.nbuckets > max_nbuckets)
+            max_nbuckets = lf.current->ht.nbuckets;
+    }
+    long count = 0;
+    for (int key=0; key<NKEYS; key++) {
+        int found = -1;
+        rv = jadwal_lockfree_find(&h, &key, &found);
+        assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(!expected[key] || found == expected[key] - 1);
+        count += expected[key] != 0;
+    }
+    assert(jadwal_lockfree_count(&lf) == count);
+    assert(lf.nresizes >= 10 && max_nbuckets < 4 * NKEYS); //about half of the keys are in at any time
+    jadwal_lockfree_handle_deinit(&h);
+    jadwal_lockfree_deinit(&lf);
+}
+
+//every thread inserts all of the keys (so they race on each one, exactly one insert of a key wins), removes the ones
+//that are its own (key % NTHREADS) and looks up random ones, while the table grows
+#define NTHREADS 4
+#define NKEYS_THREADS 100000
+struct test_threads_shared {
+    struct jadwal_lockfree lf;
+    long nwon[NTHREADS];
+};
+struct test_thread_arg {
+    struct test_threads_shared *shared;
+    int thread_idx;
+};
+static void *test_thread_main(void *arg_) {
+    struct test_thread_arg *arg = arg_;
+    struct test_threads_shared *shared = arg->shared;
+    struct jadwal_lockfree_handle h;
+    jadwal_lockfree_handle_init(&shared->lf, &h);
+    unsigned long state = 0x9E3779B97F4A7C15UL * (arg->thread_idx + 1);
+    long nwon = 0;
+    for (int i=0; i<NKEYS_THREADS; i++) {
+        int key = (i + arg->thread_idx * (NKEYS_THREADS / NTHREADS)) % NKEYS_THREADS; //start at different places
+        int value = key * 3;
+        int rv = jadwal_lockfree_insert(&h, &key, &value);
+        assert(rv == JADWAL_OK || rv == JADWAL_DUPLICATE_KEY);
+        nwon += rv == JADWAL_OK;
+        //found no matter who won, unless the thread that owns it has removed it since
+        value = -1;
+        rv = jadwal_lockfree_find(&h, &key, &value);
+        assert((rv == JADWAL_OK && value == key * 3) || (rv == JADWAL_NOT_FOUND && key % 3 == 0));
+
+        int other = test_rand_r(&state) % NKEYS_THREADS;
+        value = -1;
+        rv = jadwal_lockfree_find(&h, &other, &value);
+        assert(rv == JADWAL_NOT_FOUND || value == other * 3);
+        other = -1 - other;
+        rv = jadwal_lockfree_find(&h, &other, NULL);
+        assert(rv == JADWAL_NOT_FOUND);
+
+        if (key % NTHREADS == arg->thread_idx && key % 3 == 0) {
+            //only this thread removes it, every thread inserts it once though, so it can come back
+            rv = jadwal_lockfree_remove(&h, &key);
+            assert(rv == JADWAL_OK || rv == JADWAL_NOT_FOUND);
+            nwon -= rv == JADWAL_OK;
+        }
+    }
+    shared->nwon[arg->thread_idx] = nwon;
+    jadwal_lockfree_handle_deinit(&h);
+    return NULL;
+}
+void test_threads(void) {
+    static struct test_threads_shared shared;
+    int rv = jadwal_lockfree_init_with_udata(&shared.lf, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    pthread_t threads[NTHREADS];
+    struct test_thread_arg args[NTHREADS];
+    for (int i=0; i<NTHREADS; i++) {
+        args[i].shared = &shared;
+        args[i].thread_idx = i;
+        rv = pthread_create(&threads[i], NULL, test_thread_main, &args[i]);
+        assert(rv == 0);
+    }
+    for (int i=0; i<NTHREADS; i++)
+        pthread_join(threads[i], NULL);
+    assert(shared.lf.nresizes >= 3);
+    assert(!shared.lf.retired);
+
+    //what's left is the wins minus the removes
+    long nleft = 0;
+    for (int i=0; i<NTHREADS; i++)
+        nleft += shared.nwon[i];
+    assert(jadwal_lockfree_count(&shared.lf) == nleft);
+    struct jadwal_lockfree_handle h;
+    jadwal_lockfree_handle_init(&shared.lf, &h);
+    long nfound = 0;
+    for (int key=0; key<NKEYS_THREADS; key++) {
+        int value = -1;
+        rv = jadwal_lockfree_find(&h, &key, &value);
+        assert(key % 3 == 0 || rv == JADWAL_OK);
+        assert(rv == JADWAL_NOT_FOUND || value == key * 3);
+        nfound += rv == JADWAL_OK;
+    }
+    assert(nfound == nleft);
+    jadwal_lockfree_handle_deinit(&h);
+    jadwal_lockfree_deinit(&shared.lf);
+}
+
+int main(void) {
+    test_basic();
+    test_busy();
+    test_churn();
+    test_threads();
+    printf("success\n");
+}
@@ -0,0 +1,225 @@
+//must define this in build system, otherwise the tests are useless #define JADWAL_DBG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+typedef int jadwal_key_type; 
+typedef int jadwal_value_type; 
+
+//the identity hash, the shard has to come from mixed bits for the keys to spread
+
+#ifdef JADWAL_DATA_ARG
+int mydata[] = {213123,2313123,664536,3423424,31231231};
+void assert_udata_is_ok(void *udata) {
+    for (int i=0;  i < (int)(sizeof mydata / sizeof mydata[0]); i++) {
+        int *data = (int *) udata;
+        assert(data[i] == mydata[i]);
+    }
+}
+size_t jadwal_hash(void *udata, jadwal_key_type *key) {
+    assert_udata_is_ok(udata);
+    return (size_t) *key;
+}
+
+bool jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    assert_udata_is_ok(udata);
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA mydata
+#else
+size_t jadwal_hash(jadwal_key_type *key) {
+    return (size_t) *key;
+}
+
+bool jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    return *key_1 == *key_2 ? 0 : 1;
+}
+#define TEST_UDATA NULL
+#endif
+#include "../src/jadwal_sharded.h"
+
+void test_basic(void) {
+    struct jadwal_sharded s;
+    int rv = jadwal_sharded_init(&s, 3, 0);
+    assert(rv == JADWAL_INVALID_REQ_SZ);
+    rv = jadwal_sharded_init_with_udata(&s, 8, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<20000; i++) {
+        int value = i * 3;
+        rv = jadwal_sharded_insert(&s, &i, &value);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_sharded_insert(&s, &i, &value);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+    }
+    assert(jadwal_sharded_count(&s) == 20000);
+    //every shard got its share, and its keys are spread over all of its buckets (with JADWAL_POW2 they'd all be in
+    //one eighth of them if the shard came from the same bits as the bucket)
+    for (long i=0; i<s.nshards; i++) {
+        long count = jadwal_count(&s.shards[i].ht);
+        assert(count > 20000 / 8 / 2 && count < 20000 / 8 * 2);
+        long nper_eighth[8] = {0};
+        struct jadwal *ht = &s.shards[i].ht;
+        struct jadwal_iter iter;
+        for (rv = jadwal_begin_iterator(ht, &iter); rv == JADWAL_OK; rv = jadwal_iter_next(ht, &iter))
+            nper_eighth[iter.current_idx * 8 / ht->nbuckets]++;
+        for (int j=0; j<8; j++)
+            assert(nper_eighth[j] > count / 8 / 2);
+        assert((uintptr_t) &s.shards[i] % JADWAL_SHARDED_ALIGN == 0);
+    }
+    for (int i=0; i<40000; i++) {
+        int value = -1;
+        rv = jadwal_sharded_find(&s, &i, &value);
+        assert(rv == (i < 20000 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(value == (i < 20000 ? i * 3 : -1));
+    }
+    for (int i=0; i<20000; i+=2) {
+        rv = jadwal_sharded_remove(&s, &i);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_sharded_remove(&s, &i);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    assert(jadwal_sharded_count(&s) == 10000);
+    for (int i=0; i<20000; i++) {
+        rv = jadwal_sharded_find(&s, &i, NULL);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_sharded_deinit(&s);
+
+    //a single shard is just a locked table
+    rv = jadwal_sharded_init_with_udata(&s, 1, 100, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<1000; i++)
+        assert(jadwal_sharded_insert(&s, &i, &i) == JADWAL_OK);
+    assert(jadwal_sharded_count(&s) == 1000 && jadwal_count(&s.shards[0].ht) == 1000);
+    jadwal_sharded_deinit(&s);
+}
+
+struct test_foreach_arg {
+    long nvisited;
+    long sum;
+    long stop_after;
+};
+static int test_foreach_visit(jadwal_key_type *key, jadwal_value_type *value, void *arg_) {
+    struct test_foreach_arg *arg = arg_;
+    assert(*value == *key * 3);
+    *value = *key * 5;
+    arg->sum += *key;
+    arg->nvisited++;
+    return arg->nvisited == arg->stop_after ? 7 : 0;
+}
+void test_foreach(void) {
+    struct jadwal_sharded s;
+    int rv = jadwal_sharded_init_with_udata(&s, 4, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    struct test_foreach_arg arg = {0, 0, -1};
+    assert(jadwal_sharded_foreach(&s, test_foreach_visit, &arg) == JADWAL_OK && arg.nvisited == 0);
+    long sum = 0;
+    for (int i=0; i<5000; i++) {
+        int value = i * 3;
+        assert(jadwal_sharded_insert(&s, &i, &value) == JADWAL_OK);
+        sum += i;
+    }
+    rv = jadwal_sharded_foreach(&s, test_foreach_visit, &arg);
+    assert(rv == JADWAL_OK && arg.nvisited == 5000 && arg.sum == sum);
+    for (int i=0; i<5000; i++) {
+        int value = -1;
+        assert(jadwal_sharded_find(&s, &i, &value) == JADWAL_OK && value == i * 5);
+        value = i * 3;
+        assert(jadwal_sharded_remove(&s, &i) == JADWAL_OK && jadwal_sharded_insert(&s, &i, &value) == JADWAL_OK);
+    }
+    //stopping returns what the callback returned, and leaves the shard unlocked
+    struct test_foreach_arg stop_arg = {0, 0, 100};
+    rv = jadwal_sharded_foreach(&s, test_foreach_visit, &stop_arg);
+    assert(rv == 7 && stop_arg.nvisited == 100);
+    assert(jadwal_sharded_count(&s) == 5000);
+    jadwal_sharded_deinit(&s);
+}
+
+//every thread inserts all of the keys (so they race on each one, exactly one insert of a key wins), removes the ones
+//that are its own (key % NTHREADS) and looks up random ones, while the shards grow
+#define NTHREADS 4
+#define NKEYS_THREADS 100000
+struct test_threads_shared {
+    struct jadwal_sharded s;
+    long nwon[NTHREADS];
+};
+struct test_thread_arg {
+    struct test_threads_shared *shared;
+    int thread_idx;
+};
+static unsigned long test_rand_r(unsigned long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+static void *test_thread_main(void *arg_) {
+    struct test_thread_arg *arg = arg_;
+    struct jadwal_sharded *s = &arg->shared->s;
+    unsigned long state = 0x9E3779B97F4A7C15UL * (arg->thread_idx + 1);
+    long nwon = 0;
+    for (int i=0; i<NKEYS_THREADS; i++) {
+        int key = (i + arg->thread_idx * (NKEYS_THREADS / NTHREADS)) % NKEYS_THREADS; //start at different places
+        int value = key * 3;
+        int rv = jadwal_sharded_insert(s, &key, &value);
+        assert(rv == JADWAL_OK || rv == JADWAL_DUPLICATE_KEY);
+        nwon += rv == JADWAL_OK;
+        value = -1;
+        rv = jadwal_sharded_find(s, &key, &value);
+        assert((rv == JADWAL_OK && value == key * 3) || (rv == JADWAL_NOT_FOUND && key % 3 == 0));
+
+        int other = test_rand_r(&state) % NKEYS_THREADS;
+        value = -1;
+        rv = jadwal_sharded_find(s, &other, &value);
+        assert(rv == JADWAL_NOT_FOUND || value == other * 3);
+        other = -1 - other;
+        rv = jadwal_sharded_find(s, &other, NULL);
+        assert(rv == JADWAL_NOT_FOUND);
+
+        if (key % NTHREADS == arg->thread_idx && key % 3 == 0) {
+            rv = jadwal_sharded_remove(s, &key);
+            assert(rv == JADWAL_OK || rv == JADWAL_NOT_FOUND);
+            nwon -= rv == JADWAL_OK;
+        }
+        if (i % 10000 == 0)
+            assert(jadwal_sharded_count(s) <= NKEYS_THREADS);
+    }
+    arg->shared->nwon[arg->thread_idx] = nwon;
+    return NULL;
+}
+void test_threads(void) {
+    static struct test_threads_shared shared;
+    int rv = jadwal_sharded_init_with_udata(&shared.s, 16, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    pthread_t threads[NTHREADS];
+    struct test_thread_arg args[NTHREADS];
+    for (int i=0; i<NTHREADS; i++) {
+        args[i].shared = &shared;
+        args[i].thread_idx = i;
+        rv = pthread_create(&threads[i], NULL, test_thread_main, &args[i]);
+        assert(rv == 0);
+    }
+    for (int i=0; i<NTHREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    //what's left is the wins minus the removes
+    long nleft = 0;
+    for (int i=0; i<NTHREADS; i++)
+        nleft += shared.nwon[i];
+    assert(jadwal_sharded_count(&shared.s) == nleft);
+    for (int key=0; key<NKEYS_THREADS; key++) {
+        int value = -1;
+        rv = jadwal_sharded_find(&shared.s, &key, &value);
+        assert((rv == JADWAL_OK && value == key * 3) || (rv == JADWAL_NOT_FOUND && key % 3 == 0));
+    }
+    jadwal_sharded_deinit(&shared.s);
+}
+
+int main(void) {
+    test_basic();
+    test_foreach();
+    test_threads();
+    printf("success\n");
+}
@@ -0,0 +1,297 @@
+//must define this in build system, otherwise the tests are useless #define JADWAL_DBG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+typedef int jadwal_value_type; 
+
+//JADWAL_STR_KEYS provides jadwal_hash() and jadwal_key_eq_cmp(), this replaces the hash of the bytes (fnv-1a) to count
+//the calls
+long hash_calls = 0;
+size_t test_str_hash(const char *ptr, size_t len) {
+    hash_calls++;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i=0; i<len; i++)
+        h = (h ^ (unsigned char) ptr[i]) * 1099511628211ULL;
+    return (size_t) h;
+}
+#define JADWAL_STR_KEYS
+#define JADWAL_STR_HASH(ptr, len) test_str_hash((ptr), (len))
+#include "../src/jadwal.h"
+
+#ifdef JADWAL_DATA_ARG
+int mydata[] = {213123,2313123,664536,3423424,31231231};
+#define TEST_UDATA mydata
+#else
+#define TEST_UDATA NULL
+#endif
+
+#ifdef JADWAL_STR_INLINE
+#define TEST_INLINE_MAX JADWAL_STR_INLINE_MAX
+#else
+#define TEST_INLINE_MAX 0
+#endif
+
+#define NSTR 5000
+#define STR_MAX 48
+static char strs[NSTR][STR_MAX];
+static size_t lens[NSTR];
+//numbers, and two lengths of keys that share their first 15 bytes (the longer ones aren't inline with
+//JADWAL_STR_INLINE), all the keys of a length only differ in their last bytes
+static void test_make_strs(void) {
+    for (int i=0; i<NSTR; i++) {
+        if (i % 3 == 0)
+            lens[i] = snprintf(strs[i], STR_MAX, "%d", i);
+        else if (i % 3 == 1)
+            lens[i] = snprintf(strs[i], STR_MAX, "longlong_prefix%08d", i);
+        else
+            lens[i] = snprintf(strs[i], STR_MAX, "longlong_prefix_that_is_longer_%08d", i);
+    }
+}
+
+void test_basic(void) {
+    test_make_strs();
+    struct jadwal ht;
+    int rv = jadwal_init_with_udata(&ht, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<NSTR; i++) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    assert(jadwal_count(&ht) == NSTR);
+    //looked up through slices of another buffer, they aren't NUL terminated and point elsewhere
+    static char buff[NSTR * STR_MAX];
+    long at = 0;
+    for (int i=0; i<NSTR; i++) {
+        memcpy(buff + at, strs[i], lens[i]);
+        jadwal_key_type key = jadwal_str_make(buff + at, lens[i]);
+        at += lens[i];
+        buff[at++] = 'x';
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+        //the stored key is the inserted one (or a copy of it if it's inline)
+        const char *stored = jadwal_str_data(jadwal_iter_key(&iter));
+        assert(stored == strs[i] || (lens[i] <= TEST_INLINE_MAX && memcmp(stored, strs[i], lens[i]) == 0));
+        //one byte longer (the 'x') is another key, and so is a long one a byte shorter (a number can be a key)
+        key = jadwal_str_make(buff + at - lens[i] - 1, lens[i] + 1);
+        assert(jadwal_find(&ht, &key, &iter) == JADWAL_NOT_FOUND);
+        key = jadwal_str_make(buff + at - lens[i] - 1, lens[i] - 1);
+        assert(jadwal_find(&ht, &key, &iter) == JADWAL_NOT_FOUND || i % 3 == 0);
+    }
+    for (int i=0; i<NSTR; i+=2) {
+        jadwal_key_type key = jadwal_str_from_cstr(strs[i]);
+        rv = jadwal_remove(&ht, &key);
+        assert(rv == JADWAL_OK);
+    }
+    assert(jadwal_count(&ht) == NSTR / 2);
+    for (int i=0; i<NSTR; i++) {
+        jadwal_key_type key = jadwal_str_from_cstr(strs[i]);
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_deinit(&ht);
+}
+
+//the length decides, not a NUL byte, and the empty string is a key too
+void test_edge_keys(void) {
+    struct jadwal ht;
+    int rv = jadwal_init_with_udata(&ht, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    const char bytes[] = "a\0b_a\0c_12345678a12345678b";
+    jadwal_key_type keys[] = {
+        jadwal_str_make(bytes, 3),      //"a\0b"
+        jadwal_str_make(bytes + 4, 3),  //"a\0c"
+        jadwal_str_make(bytes, 1),      //"a"
+        jadwal_str_make(bytes + 8, 9),  //"12345678a"
+        jadwal_str_make(bytes + 17, 9), //"12345678b", the same first 8 bytes
+        jadwal_str_make(NULL, 0),
+    };
+    int nkeys = sizeof keys / sizeof keys[0];
+    for (int i=0; i<nkeys; i++) {
+        rv = jadwal_insert(&ht, &keys[i], &i);
+        assert(rv == JADWAL_OK);
+    }
+    for (int i=0; i<nkeys; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &keys[i], &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+    }
+    jadwal_key_type empty = jadwal_str_from_cstr("");
+    assert(jadwal_remove(&ht, &empty) == JADWAL_OK && jadwal_count(&ht) == nkeys - 1);
+    jadwal_deinit(&ht);
+}
+
+//keys of another length (or with JADWAL_STR_PREFIX other first 8 bytes, with JADWAL_STR_INLINE another beginning) are
+//told apart without reading the string
+static int test_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+#ifdef JADWAL_DATA_ARG
+    return jadwal_key_eq_cmp(TEST_UDATA, key_1, key_2);
+#else
+    return jadwal_key_eq_cmp(key_1, key_2);
+#endif
+}
+void test_no_deref(void) {
+    jadwal_key_type stored = jadwal_str_from_cstr("a string that is long enough not to be inline");
+    jadwal_key_type other_len = jadwal_str_make(NULL, 0);
+    other_len.len = stored.len + 1;
+    assert(test_eq_cmp(&other_len, &stored) != 0);
+#if defined(JADWAL_STR_PREFIX)
+    jadwal_key_type other_prefix = stored;
+    other_prefix.ptr = NULL;
+    other_prefix.prefix ^= 1;
+    assert(test_eq_cmp(&other_prefix, &stored) != 0);
+#elif defined(JADWAL_STR_INLINE)
+    jadwal_key_type other_prefix = stored;
+    other_prefix.u.ext.ptr = NULL;
+    other_prefix.u.ext.prefix[sizeof other_prefix.u.ext.prefix - 1] ^= 1;
+    assert(test_eq_cmp(&other_prefix, &stored) != 0);
+#endif
+}
+
+#ifdef JADWAL_STR_INLINE
+//short keys are copied into the buckets, the buffer they were made from can be reused right away
+void test_inline_copies(void) {
+    struct jadwal ht;
+    int rv = jadwal_init_with_udata(&ht, 0, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    char buff[JADWAL_STR_INLINE_MAX + 1];
+    for (int i=0; i<NSTR; i++) {
+        int len = snprintf(buff, sizeof buff, "k%d", i * 7919);
+        jadwal_key_type key = jadwal_str_make(buff, len);
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+        memset(buff, '?', sizeof buff);
+    }
+    for (int i=0; i<NSTR; i++) {
+        int len = snprintf(buff, sizeof buff, "k%d", i * 7919);
+        jadwal_key_type key = jadwal_str_make(buff, len);
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+        assert(jadwal_str_data(jadwal_iter_key(&iter)) != buff);
+    }
+    //exactly JADWAL_STR_INLINE_MAX bytes is still inline, one more isn't
+    memset(buff, 'a', sizeof buff);
+    jadwal_key_type key = jadwal_str_make(buff, JADWAL_STR_INLINE_MAX);
+    assert(jadwal_str_data(&key) != buff);
+    key = jadwal_str_make(buff, JADWAL_STR_INLINE_MAX + 1);
+    assert(jadwal_str_data(&key) == buff);
+    jadwal_deinit(&ht);
+}
+#endif
+
+#ifdef JADWAL_ARENA
+//an allocator that counts what is still allocated
+long test_nallocs = 0;
+void *test_count_malloc(size_t sz, void *udata) {
+    (void) udata;
+    void *p = malloc(sz);
+    test_nallocs += p != NULL;
+    return p;
+}
+void *test_count_realloc(void *p, size_t sz, void *udata) {
+    (void) udata;
+    return realloc(p, sz);
+}
+void test_count_free(void *p, void *udata) {
+    (void) udata;
+    test_nallocs -= p != NULL;
+    free(p);
+}
+//the table keeps its own copies of keys inserted with jadwal_insert_copy(), made from a buffer that is reused
+void test_insert_copy(void) {
+    struct jadwal ht;
+    int rv = jadwal_init_ex(&ht, 0, test_count_malloc, test_count_realloc, test_count_free, TEST_UDATA,
+                            JADWAL_DEFAULT_SHRINK_AT, JADWAL_DEFAULT_GROW_AT);
+    assert(rv == JADWAL_OK);
+    char buff[STR_MAX];
+    for (int i=0; i<NSTR; i++) {
+        memcpy(buff, strs[i], lens[i]);
+        jadwal_key_type key = jadwal_str_make(buff, lens[i]);
+        rv = jadwal_insert_copy(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+        assert(jadwal_insert_copy(&ht, &key, &i) == JADWAL_DUPLICATE_KEY);
+        memset(buff, '?', sizeof buff);
+    }
+    //only the keys that don't fit in a bucket take arena memory, a duplicate doesn't
+    size_t nbytes = 0;
+    for (int i=0; i<NSTR; i++) {
+        if (lens[i] > TEST_INLINE_MAX)
+            nbytes += (lens[i] + JADWAL_ARENA_ALIGN - 1) / JADWAL_ARENA_ALIGN * JADWAL_ARENA_ALIGN;
+    }
+    assert(ht.arena.nbytes == nbytes);
+    for (int i=0; i<NSTR; i++) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+        const char *stored = jadwal_str_data(jadwal_iter_key(&iter));
+        assert(stored != strs[i] && memcmp(stored, strs[i], lens[i]) == 0);
+    }
+    for (int i=0; i<NSTR; i+=2) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        rv = jadwal_remove_copy(&ht, &key);
+        assert(rv == JADWAL_OK);
+        assert(jadwal_remove_copy(&ht, &key) == JADWAL_NOT_FOUND);
+    }
+    for (int i=0; i<NSTR; i+=2) {
+        if (lens[i] > TEST_INLINE_MAX)
+            nbytes -= (lens[i] + JADWAL_ARENA_ALIGN - 1) / JADWAL_ARENA_ALIGN * JADWAL_ARENA_ALIGN;
+    }
+    assert(ht.arena.nbytes == nbytes);
+    //the freed copies are reused, putting them back doesn't allocate another chunk
+    long nallocs = test_nallocs;
+    for (int i=0; i<NSTR; i+=2) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        rv = jadwal_insert_copy(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    assert(test_nallocs == nallocs);
+    for (int i=0; i<NSTR; i++) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+    }
+    jadwal_deinit(&ht);
+    assert(test_nallocs == 0);
+}
+#endif
+
+//a key is hashed once per operation (debug builds hash again to check jadwal_key_eq_cmp())
+void test_hash_calls(void) {
+    struct jadwal ht;
+    int rv = jadwal_init_with_udata(&ht, NSTR, TEST_UDATA);
+    assert(rv == JADWAL_OK);
+    long nbuckets = ht.nbuckets;
+    hash_calls = 0;
+    for (int i=0; i<NSTR / 2; i++) {
+        jadwal_key_type key = jadwal_str_make(strs[i], lens[i]);
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    assert(ht.nbuckets == nbuckets);
+#ifndef JADWAL_DBG
+    assert(hash_calls == NSTR / 2);
+#endif
+    jadwal_deinit(&ht);
+}
+
+int main(void) {
+    test_basic();
+    test_edge_keys();
+    test_no_deref();
+    test_hash_calls();
+#ifdef JADWAL_STR_INLINE
+    test_inline_copies();
+#endif
+#ifdef JADWAL_ARENA
+    test_insert_copy();
+#endif
+    printf("success\n");
+}
@@ -7,6 +7,9 @@
 typedef int jadwal_key_type; 
 typedef int jadwal_value_type; 
 
+long hash_calls = 0; //how many times the table called jadwal_hash()
+long cmp_calls = 0;  //how many times the table called jadwal_key_eq_cmp()
+
 #ifdef JADWAL_DATA_ARG
 int mydata[] = {213123,2313123,664536,3423424,31231231};
 void assert_udata_is_ok(void *udata) {
@@ -17,22 +20,28 @@ void assert_udata_is_ok(void *udata) {
 }
 size_t jadwal_hash(void *udata, jadwal_key_type *key) {
     assert_udata_is_ok(udata);
+    __atomic_fetch_add(&hash_calls, 1, __ATOMIC_RELAXED); //parallel resizes hash from several threads
     return *key;
 }
 
 bool jadwal_key_eq_cmp(void *udata, jadwal_key_type *key_1, jadwal_key_type *key_2) {
     assert_udata_is_ok(udata);
+    cmp_calls++;
     return *key_1 == *key_2 ? 0 : 1;
 }
 #else
 size_t jadwal_hash(jadwal_key_type *key) {
+    __atomic_fetch_add(&hash_calls, 1, __ATOMIC_RELAXED); //parallel resizes hash from several threads
     return *key;
 }
 
 bool jadwal_key_eq_cmp(jadwal_key_type *key_1, jadwal_key_type *key_2) {
+    cmp_calls++;
     return *key_1 == *key_2 ? 0 : 1;
 }
 #endif
+long prefetch_key_calls = 0; //how many likely matches jadwal_find_batch() prefetched the stored key of
+#define JADWAL_PREFETCH_KEY(key) (prefetch_key_calls++, (void) (key)) //int keys don't point anywhere
 #include "../src/jadwal.h"
 
 /*
@@ -191,9 +200,13 @@ void test_find_all_arr2(struct jadwal *ht, int arr[][2], int nelems) {
         struct jadwal_iter iter;
         int rv = jadwal_find(ht, &arr[i][0], &iter);
         assert(rv == JADWAL_OK);
-        assert(iter.pair);
-        assert(iter.pair->key == arr[i][0]);
-        assert(iter.pair->value == arr[i][1]);
+        assert(jadwal_iter_key(&iter));
+        assert(*jadwal_iter_key(&iter) == arr[i][0]);
+        assert(*jadwal_iter_value(&iter) == arr[i][1]);
+#ifndef JADWAL_SOA
+        assert(&iter.pair->key == jadwal_iter_key(&iter));
+        assert(&iter.pair->value == jadwal_iter_value(&iter));
+#endif
     }
 }
 
@@ -217,8 +230,8 @@ void test_iter_expect_seen(struct jadwal *ht, int arr[][2], int nelems, long exp
     jadwal_begin_iterator(ht, &iter);
     long len = 0;
     for (; jadwal_iter_check(&iter); jadwal_iter_next(ht, &iter)) {
-        assert(iter.pair);
-        bool *seen_entry = seen + xlinear_find(arr, nelems, iter.pair->key);
+        assert(jadwal_iter_key(&iter));
+        bool *seen_entry = seen + xlinear_find(arr, nelems, *jadwal_iter_key(&iter));
         assert(!*seen_entry);
         *seen_entry = 1;
         len++;
@@ -239,7 +252,7 @@ void test_iter_expect_count(struct jadwal *ht, long expected_len) {
     jadwal_begin_iterator(ht, &iter);
     long len = 0;
     for (; jadwal_iter_check(&iter); jadwal_iter_next(ht, &iter)) {
-        assert(iter.pair);
+        assert(jadwal_iter_key(&iter));
         len++;
     }
     assert(len == expected_len);
@@ -288,7 +301,976 @@ void test_init_add_arrays_find(void) {
     jadwal_deinit(&ht);
 }
 
+//random inserts / removes / finds checked against a plain array, the small key range makes collisions, long clusters
+//and tombstones common
+#define RANDOM_OPS_NKEYS 3000
+#define RANDOM_OPS_NOPS  200000
+static unsigned long test_rand_state = 88172645463325252UL;
+static unsigned long test_rand(void) {
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 7;
+    test_rand_state ^= test_rand_state << 17;
+    return test_rand_state;
+}
+//the counters must agree with the bucket states
+void test_check_bucket_counts(struct jadwal *ht) {
+    long noccupied = 0;
+    long ndeleted = 0;
+    for (long idx=0; idx<ht->nbuckets; idx++) {
+        noccupied += jadwal_slot_is_occupied(ht, idx);
+        ndeleted += jadwal_slot_is_deleted(ht, idx);
+    }
+    assert(noccupied == ht->nelements);
+    assert(ndeleted == ht->ndeleted);
+}
+#ifdef JADWAL_HOPSCOTCH
+//every element must be marked in its home bucket's bitmap, and nothing else may be marked
+void test_check_hop_bitmaps(struct jadwal *ht) {
+    long nbits = 0;
+    for (long idx=0; idx<ht->nbuckets; idx++) {
+        for (jadwal_hop_mask hop = ht->hop[idx]; hop; hop &= hop - 1)
+            nbits++;
+        if (!jadwal_slot_is_occupied(ht, idx))
+            continue;
+#ifdef JADWAL_DATA_ARG
+        long home = jadwal_integer_mod_buckets(ht, jadwal_hash(ht->userdata, jadwal_key_at(ht, idx)));
+#else
+        long home = jadwal_integer_mod_buckets(ht, jadwal_hash(jadwal_key_at(ht, idx)));
+#endif
+        long dist = idx - home < 0 ? idx - home + ht->nbuckets : idx - home;
+        assert(dist < JADWAL_HOP_RANGE);
+        assert(ht->hop[home] & ((jadwal_hop_mask) 1 << dist));
+    }
+    assert(nbits == ht->nelements);
+}
+#endif
+
+void test_random_ops(void) {
+    static bool present[RANDOM_OPS_NKEYS];
+    static int  expected_value[RANDOM_OPS_NKEYS];
+    memset(present, 0, sizeof present);
+    long count = 0;
+
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+
+    for (int i=0; i<RANDOM_OPS_NOPS; i++) {
+        //stay around a third of the key range for the first half, then drift towards emptying the table
+        int key = test_rand() % RANDOM_OPS_NKEYS;
+        int value = test_rand() % 100000;
+        int op = test_rand() % 8;
+        bool prefer_remove = (i > RANDOM_OPS_NOPS / 2) ? (op < 5) : (count > RANDOM_OPS_NKEYS / 3 && op < 4);
+        struct jadwal_iter iter;
+        if (prefer_remove) {
+            rv = jadwal_remove(&ht, &key);
+            assert(rv == (present[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            if (present[key])
+                count--;
+            present[key] = false;
+        }
+        else if (op < 6) {
+            rv = jadwal_insert(&ht, &key, &value);
+            assert(rv == (present[key] ? JADWAL_DUPLICATE_KEY : JADWAL_OK));
+            if (!present[key]) {
+                count++;
+                expected_value[key] = value;
+            }
+            present[key] = true;
+        }
+        else {
+            rv = jadwal_find(&ht, &key, &iter);
+            assert(rv == (present[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+            if (present[key]) {
+                assert(*jadwal_iter_key(&iter) == key);
+                assert(*jadwal_iter_value(&iter) == expected_value[key]);
+            }
+        }
+        if (i % 5000 == 0) {
+            test_iter_expect_count(&ht, count);
+            test_check_bucket_counts(&ht);
+#ifdef JADWAL_HOPSCOTCH
+            test_check_hop_bitmaps(&ht);
+#endif
+        }
+    }
+    test_iter_expect_count(&ht, count);
+    for (int key=0; key<RANDOM_OPS_NKEYS; key++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == (present[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_deinit(&ht);
+}
+
+//a table that stays the same size while keys come and go (insert a new key, remove a random live one)
+//must neither grow nor run out of empty buckets, the tombstones get purged in place
+#define CHURN_NLIVE 2000
+#define CHURN_NOPS  300000
+void test_churn(void) {
+    static int live[CHURN_NLIVE];
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, CHURN_NLIVE);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    //spread the keys out so that removals leave tombstones in the middle of clusters
+    for (int i=0; i<CHURN_NLIVE; i++) {
+        live[i] = i * 7;
+        rv = jadwal_insert(&ht, &live[i], &i);
+        assert(rv == JADWAL_OK);
+    }
+    long nbuckets = ht.nbuckets;
+    for (int i=CHURN_NLIVE; i<CHURN_NOPS; i++) {
+        int key = i * 7;
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+        int slot = test_rand() % CHURN_NLIVE;
+        rv = jadwal_remove(&ht, &live[slot]);
+        assert(rv == JADWAL_OK);
+        live[slot] = key;
+        assert(ht.nelements == CHURN_NLIVE);
+        assert(ht.ndeleted <= ht.purge_at_gt_n + 1);
+        if (i % 20000 == 0)
+            test_check_bucket_counts(&ht);
+    }
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+    assert(ht.nbuckets == nbuckets); //robin hood and hopscotch may grow to stay within their probe limits
+#endif
+    (void) nbuckets;
+    test_check_bucket_counts(&ht);
+    for (int i=0; i<CHURN_NLIVE; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &live[i], &iter);
+        assert(rv == JADWAL_OK);
+        assert(*jadwal_iter_value(&iter) == live[i] / 7);
+    }
+    jadwal_deinit(&ht);
+}
+
+//keys that only differ in their high bits, with the identity hash this is the worst case for a table that
+//takes the hash modulo a power of two directly
+#define STRIDED_NKEYS  4000
+#define STRIDED_SHIFT  12
+void test_strided_keys(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    for (int i=0; i<STRIDED_NKEYS; i++) {
+        int key = i << STRIDED_SHIFT;
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    test_iter_expect_count(&ht, STRIDED_NKEYS);
+    for (int i=0; i<STRIDED_NKEYS; i++) {
+        int key = i << STRIDED_SHIFT;
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK);
+        assert(*jadwal_iter_value(&iter) == i);
+        key++;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    for (int i=0; i<STRIDED_NKEYS; i += 2) {
+        int key = i << STRIDED_SHIFT;
+        rv = jadwal_remove(&ht, &key);
+        assert(rv == JADWAL_OK);
+    }
+    test_iter_expect_count(&ht, STRIDED_NKEYS / 2);
+#ifdef JADWAL_STATS
+    //every insert, both finds and every remove
+    assert(ht.stats.nlookups >= STRIDED_NKEYS * 3 + STRIDED_NKEYS / 2);
+    assert(ht.stats.max_probe_len >= 1 && ht.stats.nprobes >= ht.stats.nlookups);
+#endif
+    jadwal_deinit(&ht);
+}
+
+#ifdef __SIZEOF_INT128__
+//the precomputed reciprocals must agree with the % operator over the full 64 bit range
+void test_fastmod(void) {
+    for (int power=2; power < (int) adiv_n_values; power++) {
+        uint64_t d = adiv_values[power];
+        uint64_t edges[] = { 0, 1, d - 1, d, d + 1, UINT32_MAX, (uint64_t) UINT32_MAX + 1, UINT64_MAX - d, UINT64_MAX - 1, UINT64_MAX };
+        for (int i=0; i < (int) (sizeof edges / sizeof edges[0]); i++)
+            assert(adiv_fastmod(edges[i], power) == edges[i] % d);
+        for (int i=0; i<10000; i++) {
+            uint64_t n = ((uint64_t) test_rand() << 32) ^ test_rand();
+            assert(adiv_fastmod(n, power) == n % d);
+        }
+    }
+}
+#endif
+
+#ifdef JADWAL_STORE_HASH
+//growing from the minimum size to STORE_HASH_NKEYS resizes many times, none of which should hash a key again
+#define STORE_HASH_NKEYS 20000
+void test_store_hash(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    hash_calls = 0;
+    for (int i=0; i<STORE_HASH_NKEYS; i++) {
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+    }
+    //one per insert, robin hood and hopscotch can look a key up again after growing in the middle of an insert
+    assert(hash_calls >= STORE_HASH_NKEYS && hash_calls < STORE_HASH_NKEYS + STORE_HASH_NKEYS / 100);
+    for (int i=0; i<STORE_HASH_NKEYS; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == JADWAL_OK);
+        assert(*jadwal_iter_value(&iter) == i);
+    }
+    //the hash moved along with every element (the test hash is the identity)
+    for (long idx=0; idx<ht.nbuckets; idx++) {
+        if (jadwal_slot_is_occupied(&ht, idx))
+            assert(*jadwal_hash_at(&ht, idx) == (size_t) *jadwal_key_at(&ht, idx));
+    }
+    jadwal_deinit(&ht);
+}
+#endif
+
+//resizing moves known unique keys into a clean table, it must never compare keys
+#define RESIZE_NKEYS 30000
+void test_resize_no_key_cmp(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    for (int i=0; i<RESIZE_NKEYS; i++) {
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+    }
+    //leave some tombstones behind in the old table
+    for (int i=0; i<RESIZE_NKEYS; i += 3) {
+        rv = jadwal_remove(&ht, &i);
+        assert(rv == JADWAL_OK);
+    }
+    rv = jadwal_maintenance(&ht, ht.nbuckets * 4); //with JADWAL_INCREMENTAL finish moving, jadwal_resize__ only moves ht
+    assert(rv == JADWAL_OK && !jadwal_resizing(&ht));
+    long nelements = ht.nelements;
+    long nbuckets = ht.nbuckets;
+    cmp_calls = 0;
+    hash_calls = 0;
+    rv = jadwal_resize__(&ht, nbuckets * 2);
+    assert(rv == JADWAL_OK);
+    assert(ht.nbuckets > nbuckets);
+    assert(ht.nelements == nelements);
+    assert(ht.ndeleted == 0);
+    assert(cmp_calls == 0);
+#ifdef JADWAL_STORE_HASH
+    assert(hash_calls == 0);
+#else
+    assert(hash_calls == nelements);
+#endif
+    for (int i=0; i<RESIZE_NKEYS; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        if (i % 3 == 0) {
+            assert(rv == JADWAL_NOT_FOUND);
+        }
+        else {
+            assert(rv == JADWAL_OK);
+            assert(*jadwal_iter_value(&iter) == i);
+        }
+    }
+    jadwal_deinit(&ht);
+}
+
+//an allocator that hands out dirty memory and counts what is still allocated
+long test_nallocs = 0;
+void *test_dirty_malloc(size_t sz, void *udata) {
+    (void) udata;
+    void *p = malloc(sz);
+    if (p) {
+        memset(p, 0xab, sz);
+        test_nallocs++;
+    }
+    return p;
+}
+void *test_dirty_realloc(void *p, size_t sz, void *udata) {
+    (void) udata;
+    return realloc(p, sz);
+}
+void test_dirty_free(void *p, void *udata) {
+    (void) udata;
+    if (p)
+        test_nallocs--;
+    free(p);
+}
+#define CUSTOM_ALLOC_NKEYS 20000
+void test_custom_alloc(void) {
+    struct jadwal ht;
+#ifdef JADWAL_DATA_ARG
+    void *udata = mydata;
+#else
+    void *udata = NULL;
+#endif
+    int rv = jadwal_init_ex(&ht, 0, test_dirty_malloc, test_dirty_realloc, test_dirty_free, udata,
+                            JADWAL_DEFAULT_SHRINK_AT, JADWAL_DEFAULT_GROW_AT);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<CUSTOM_ALLOC_NKEYS; i++) {
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+    }
+    for (int i=0; i<CUSTOM_ALLOC_NKEYS; i += 2) {
+        rv = jadwal_remove(&ht, &i);
+        assert(rv == JADWAL_OK);
+    }
+    for (int i=0; i<CUSTOM_ALLOC_NKEYS; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == (i % 2 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    assert(jadwal_count(&ht) == CUSTOM_ALLOC_NKEYS / 2);
+    jadwal_deinit(&ht);
+    assert(test_nallocs == 0);
+}
+
+#ifdef JADWAL_ARENA
+//blocks from the arena of a table that grows (and with JADWAL_INCREMENTAL moves to new buckets) in between,
+//they must keep their contents, freed ones must be reused, and jadwal_deinit() must free every chunk
+#define ARENA_NBLOCKS 3000
+void test_arena(void) {
+    static unsigned char *blocks[ARENA_NBLOCKS];
+    static size_t sizes[ARENA_NBLOCKS];
+    struct jadwal ht;
+#ifdef JADWAL_DATA_ARG
+    void *udata = mydata;
+#else
+    void *udata = NULL;
+#endif
+    int rv = jadwal_init_ex(&ht, 0, test_dirty_malloc, test_dirty_realloc, test_dirty_free, udata,
+                            JADWAL_DEFAULT_SHRINK_AT, JADWAL_DEFAULT_GROW_AT);
+    assert(rv == JADWAL_OK);
+    srand(25);
+    size_t nbytes = 0;
+    for (int i=0; i<ARENA_NBLOCKS; i++) {
+        //mostly small blocks, some bigger than JADWAL_ARENA_MAX_SMALL, and some empty ones
+        sizes[i] = (size_t) (i % 10 == 0 ? JADWAL_ARENA_MAX_SMALL + rand() % 1000 : rand() % 100);
+        blocks[i] = jadwal_arena_alloc(&ht, sizes[i]);
+        assert(blocks[i] && (uintptr_t) blocks[i] % JADWAL_ARENA_ALIGN == 0);
+        memset(blocks[i], i & 0xff, sizes[i]);
+        nbytes += sizes[i] ? (sizes[i] + JADWAL_ARENA_ALIGN - 1) / JADWAL_ARENA_ALIGN * JADWAL_ARENA_ALIGN :
+                             JADWAL_ARENA_ALIGN;
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+    }
+    assert(ht.arena.nbytes == nbytes);
+    for (int i=0; i<ARENA_NBLOCKS; i++) {
+        for (size_t j=0; j<sizes[i]; j++)
+            assert(blocks[i][j] == (i & 0xff));
+    }
+    //a freed small block is the next one handed out for its size class
+    for (int i=1; i<ARENA_NBLOCKS; i += 2) {
+        jadwal_arena_free(&ht, blocks[i], sizes[i]);
+        if (sizes[i] <= JADWAL_ARENA_MAX_SMALL) {
+            unsigned char *again = jadwal_arena_alloc(&ht, sizes[i]);
+            assert(again == blocks[i]);
+            jadwal_arena_free(&ht, again, sizes[i]);
+        }
+        blocks[i] = NULL;
+    }
+    jadwal_arena_free(&ht, NULL, 10);
+    for (int i=0; i<ARENA_NBLOCKS; i += 2) {
+        for (size_t j=0; j<sizes[i]; j++)
+            assert(blocks[i][j] == (i & 0xff));
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == i);
+    }
+    //nothing left out in the middle of growing either
+    for (int i=ARENA_NBLOCKS; i<4 * ARENA_NBLOCKS; i++) {
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+    }
+    for (int i=0; i<ARENA_NBLOCKS; i += 2) {
+        for (size_t j=0; j<sizes[i]; j++)
+            assert(blocks[i][j] == (i & 0xff));
+    }
+    assert(jadwal_arena_alloc(&ht, (size_t) -1) == NULL);
+    jadwal_deinit(&ht);
+    assert(test_nallocs == 0 && ht.arena.nbytes == 0 && !ht.arena.chunks);
+}
+#endif
+
+#ifdef JADWAL_PARALLEL_RESIZE
+//without threads, the tasks run backwards on the calling thread, which still mixes up the order buckets are claimed in
+long test_nruns = 0;
+void test_run_tasks(jadwal_task_fptr task, void *arg, long ntasks, void *userdata) {
+#ifdef JADWAL_DATA_ARG
+    assert_udata_is_ok(userdata);
+#else
+    (void) userdata;
+#endif
+    test_nruns++;
+#ifdef JADWAL_PTHREADS
+    jadwal_run_tasks_pthreads(task, arg, ntasks, userdata);
+#else
+    for (long i=ntasks-1; i>=0; i--)
+        task(arg, i);
+#endif
+}
+#define PARALLEL_NKEYS 300000
+void test_parallel_resize(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    assert(jadwal_set_task_runner(&ht, test_run_tasks, 0) == JADWAL_INVALID_REQ_SZ);
+    rv = jadwal_set_task_runner(&ht, test_run_tasks, 4);
+    assert(rv == JADWAL_OK);
+    test_nruns = 0;
+    for (int i=0; i<PARALLEL_NKEYS; i++) {
+        int key = i * 3;
+        rv = jadwal_insert(&ht, &key, &i);
+        assert(rv == JADWAL_OK);
+    }
+    assert(test_nruns > 0);
+    assert(jadwal_count(&ht) == PARALLEL_NKEYS);
+    test_check_bucket_counts(&ht);
+    for (int i=0; i<PARALLEL_NKEYS; i++) {
+        int key = i * 3;
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK);
+        assert(*jadwal_iter_value(&iter) == i);
+        key++;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    jadwal_deinit(&ht);
+}
+#endif
+
+#ifdef JADWAL_INCREMENTAL
+//growing keeps the old buckets around, each operation moves a few of them, keys that haven't been moved must still
+//behave as if they were in the table
+#define INCR_NKEYS 100000
+void test_incremental(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    long nmigrations = 0;
+    long nremoved = 0;
+    for (int i=0; i<INCR_NKEYS; i++) {
+        bool was_resizing = jadwal_resizing(&ht);
+        rv = jadwal_insert(&ht, &i, &i);
+        assert(rv == JADWAL_OK);
+        if (was_resizing || !jadwal_resizing(&ht))
+            continue;
+        //a migration just started, only a step of the old buckets has been moved
+        nmigrations++;
+        if (ht.old->nbuckets > 4 * JADWAL_MIGRATE_STEP)
+            assert(ht.old->nelements > 0);
+        assert(jadwal_count(&ht) == i + 1 - nremoved);
+        //lookups don't move anything, a value found before them stays where it was
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == JADWAL_OK);
+        int *found_value = jadwal_iter_value(&iter);
+        long old_nelements = ht.old->nelements;
+        long migrate_idx = ht.migrate_idx;
+        for (int j=nremoved; j<i; j++) {
+            rv = jadwal_find(&ht, &j, &iter);
+            assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == j);
+        }
+        assert(ht.old->nelements == old_nelements && ht.migrate_idx == migrate_idx);
+        assert(*found_value == i);
+        //the smallest key is in the old table unless it was moved already, either way it's there
+        int key = nremoved;
+        rv = jadwal_insert(&ht, &key, &key);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == key);
+        rv = jadwal_remove(&ht, &key);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_NOT_FOUND);
+        nremoved++;
+    }
+    assert(nmigrations >= 3);
+    assert(jadwal_count(&ht) == INCR_NKEYS - nremoved);
+    for (int i=0; i<INCR_NKEYS; i++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == (i < nremoved ? JADWAL_NOT_FOUND : JADWAL_OK));
+    }
+
+    //grow once more and let jadwal_maintenance() do the moving
+    long nbuckets = ht.nbuckets;
+    int next = INCR_NKEYS;
+    while (!jadwal_resizing(&ht)) {
+        rv = jadwal_insert(&ht, &next, &next);
+        assert(rv == JADWAL_OK);
+        next++;
+    }
+    assert(ht.nbuckets > nbuckets);
+    long nsteps = 0;
+    while (jadwal_resizing(&ht)) {
+        rv = jadwal_maintenance(&ht, 1000);
+        assert(rv == JADWAL_OK);
+        nsteps++;
+    }
+    assert(nsteps > 1 && nsteps <= nbuckets / 1000 + 1);
+    assert(ht.nelements == next - nremoved);
+
+    //an iterator sees everything, even in the middle of a migration
+    while (!jadwal_resizing(&ht)) {
+        rv = jadwal_insert(&ht, &next, &next);
+        assert(rv == JADWAL_OK);
+        next++;
+    }
+    //jadwal_remove_iter() on what a lookup found in the old buckets, and on an iterator whose element was moved since
+    struct jadwal_iter iter, stale;
+    int in_old[2];
+    int nin_old = 0;
+    for (int key=nremoved; key<next && nin_old<2; key++) {
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == JADWAL_OK);
+        long idx = iter.started_at_idx;
+        if (idx < ht.old->nbuckets && jadwal_iter_key(&iter) == jadwal_key_at(ht.old, idx))
+            in_old[nin_old++] = key;
+    }
+    assert(nin_old == 2);
+    rv = jadwal_find(&ht, &in_old[0], &iter);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_remove_iter(&ht, &iter);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_find(&ht, &in_old[0], &iter);
+    assert(rv == JADWAL_NOT_FOUND);
+    rv = jadwal_find(&ht, &in_old[1], &stale);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_insert(&ht, &in_old[1], &in_old[1]); //moves it to the new buckets
+    assert(rv == JADWAL_DUPLICATE_KEY);
+    rv = jadwal_remove_iter(&ht, &stale);
+    assert(rv == JADWAL_NOT_FOUND);
+    rv = jadwal_find(&ht, &in_old[1], &iter);
+    assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == in_old[1]);
+    assert(jadwal_count(&ht) == next - nremoved - 1);
+    test_iter_expect_count(&ht, next - nremoved - 1);
+    assert(!jadwal_resizing(&ht));
+    jadwal_deinit(&ht);
+}
+#endif
+
+//jadwal_find_batch() must agree with jadwal_find() on every key
+void test_find_batch(void) {
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    enum { NKEYS = 3000, NLOOKUPS = 1000 };
+    for (int i=0; i<NKEYS; i++) {
+        int value = i * 2;
+        rv = jadwal_insert(&ht, &i, &value);
+        assert(rv == JADWAL_OK);
+        if (i % 5 == 0) {
+            rv = jadwal_remove(&ht, &i);
+            assert(rv == JADWAL_OK);
+        }
+    }
+    static int keys[NLOOKUPS];
+    static struct jadwal_iter iters[NLOOKUPS];
+    static int status[NLOOKUPS];
+    srand(7);
+    bool all_found = true;
+    for (int i=0; i<NLOOKUPS; i++) {
+        keys[i] = rand() % (NKEYS + 1000) - 500;
+        all_found = all_found && keys[i] >= 0 && keys[i] < NKEYS && keys[i] % 5 != 0;
+    }
+    assert(!all_found);
+    prefetch_key_calls = 0;
+    rv = jadwal_find_batch(&ht, keys, NLOOKUPS, iters, status);
+    assert(rv == JADWAL_NOT_FOUND);
+    assert(prefetch_key_calls > 0);
+    for (int i=0; i<NLOOKUPS; i++) {
+        struct jadwal_iter iter;
+        int expected = jadwal_find(&ht, &keys[i], &iter);
+        assert(status[i] == expected);
+        assert((jadwal_iter_key(&iters[i]) != NULL) == (expected == JADWAL_OK));
+        if (expected == JADWAL_OK) {
+            assert(*jadwal_iter_key(&iters[i]) == keys[i] && *jadwal_iter_value(&iters[i]) == keys[i] * 2);
+            assert(jadwal_iter_key(&iters[i]) == jadwal_iter_key(&iter));
+        }
+    }
+    //only hits, not a multiple of the batch size, and either output can be left out
+    for (int i=0; i<NLOOKUPS; i++)
+        keys[i] = (i * 5 + 1) % NKEYS;
+    rv = jadwal_find_batch(&ht, keys, NLOOKUPS - 3, NULL, status);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<NLOOKUPS - 3; i++)
+        assert(status[i] == JADWAL_OK);
+    rv = jadwal_find_batch(&ht, keys, NLOOKUPS - 3, iters, NULL);
+    assert(rv == JADWAL_OK);
+    for (int i=0; i<NLOOKUPS - 3; i++)
+        assert(*jadwal_iter_value(&iters[i]) == keys[i] * 2);
+    rv = jadwal_find_batch(&ht, keys, 0, NULL, NULL);
+    assert(rv == JADWAL_OK);
+    jadwal_deinit(&ht);
+}
+
+//jadwal_insert_batch() must leave the table as the same inserts made one at a time would, and not grow in the middle
+void test_insert_batch(bool or_replace) {
+    struct jadwal ht;
+    struct jadwal expected_ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_init(&expected_ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+    expected_ht.userdata = mydata;
+#endif
+    for (int i=0; i<1000; i++) {
+        int value = -i;
+        rv = jadwal_insert(&ht, &i, &value);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_insert(&expected_ht, &i, &value);
+        assert(rv == JADWAL_OK);
+    }
+    enum { NBATCH = 5000 };
+    static int keys[NBATCH];
+    static int values[NBATCH];
+    static int status[NBATCH];
+    srand(11);
+    for (int i=0; i<NBATCH; i++) {
+        keys[i] = rand() % 8000; //some already in the table, some more than once in the batch
+        values[i] = i;
+    }
+    long nbuckets_before = ht.nbuckets;
+    rv = jadwal_insert_batch(&ht, keys, values, NBATCH, or_replace, status);
+    assert(rv == JADWAL_OK);
+    assert(ht.nbuckets > nbuckets_before);
+    long nnew = 0;
+    for (int i=0; i<NBATCH; i++) {
+        struct jadwal_iter iter;
+        int expected = jadwal_insert(&expected_ht, &keys[i], &values[i]);
+        if (expected == JADWAL_DUPLICATE_KEY && or_replace)
+            jadwal_find_or_insert(&expected_ht, &keys[i], &values[i], &iter);
+        assert(status[i] == expected);
+        nnew += expected == JADWAL_OK;
+    }
+    assert(jadwal_count(&ht) == jadwal_count(&expected_ht) && jadwal_count(&ht) == 1000 + nnew);
+    for (int key=0; key<8000; key++) {
+        struct jadwal_iter iter;
+        struct jadwal_iter expected_iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        int expected = jadwal_find(&expected_ht, &key, &expected_iter);
+        assert(rv == expected);
+        if (rv == JADWAL_OK)
+            assert(*jadwal_iter_value(&iter) == *jadwal_iter_value(&expected_iter));
+    }
+
+    //room is made for a whole batch up front, it's all inserted without growing
+    for (int i=0; i<NBATCH; i++)
+        keys[i] = 10000 + i;
+    rv = jadwal_reserve(&ht, NBATCH);
+    assert(rv == JADWAL_OK);
+    nbuckets_before = ht.nbuckets;
+    rv = jadwal_insert_batch(&ht, keys, values, NBATCH, or_replace, NULL);
+    assert(rv == JADWAL_OK);
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+    assert(ht.nbuckets == nbuckets_before); //those two can still grow when a probe distance / neighbourhood overflows
+#endif
+    assert(jadwal_count(&ht) == 1000 + nnew + NBATCH);
+    rv = jadwal_insert_batch(&ht, keys, values, 0, or_replace, NULL);
+    assert(rv == JADWAL_OK);
+    jadwal_deinit(&ht);
+    jadwal_deinit(&expected_ht);
+}
+
+//jadwal_build_from() sizes the table once and keeps the first value of a repeated key, with JADWAL_PARALLEL_RESIZE the
+//keys are placed by the tasks, each in its own range of buckets
+void test_build_from(void) {
+    enum { NBUILD = 50000 };
+    static int keys[NBUILD];
+    static int values[NBUILD];
+    static int first[NBUILD]; //the first value of each key, -1 if not in keys
+    for (int i=0; i<NBUILD; i++)
+        first[i] = -1;
+    srand(12);
+    for (int i=0; i<NBUILD; i++) {
+        keys[i] = i % 7 == 0 ? rand() % NBUILD : i; //some more than once
+        values[i] = i;
+        if (first[keys[i]] < 0)
+            first[keys[i]] = i;
+    }
+    long nkeys = 0;
+    for (int i=0; i<NBUILD; i++)
+        nkeys += first[i] >= 0;
+
+    struct jadwal ht;
+    struct jadwal reserved_ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+    rv = jadwal_init(&reserved_ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+    reserved_ht.userdata = mydata;
+#endif
+#ifdef JADWAL_PARALLEL_RESIZE
+    rv = jadwal_set_task_runner(&ht, test_run_tasks, 5);
+    assert(rv == JADWAL_OK);
+    test_nruns = 0;
+#endif
+    rv = jadwal_build_from(&ht, keys, values, NBUILD);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_PARALLEL_RESIZE
+    assert(test_nruns == 1);
+#endif
+    rv = jadwal_reserve(&reserved_ht, NBUILD);
+    assert(rv == JADWAL_OK);
+#if !defined(JADWAL_ROBIN_HOOD) && !defined(JADWAL_HOPSCOTCH)
+    assert(ht.nbuckets == reserved_ht.nbuckets);
+#endif
+    assert(jadwal_count(&ht) == nkeys);
+    test_check_bucket_counts(&ht);
+    for (int key=0; key<NBUILD; key++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == (first[key] >= 0 ? JADWAL_OK : JADWAL_NOT_FOUND));
+        if (rv == JADWAL_OK)
+            assert(*jadwal_iter_value(&iter) == first[key]);
+    }
+    //a table that isn't empty anymore takes the keys like jadwal_insert_batch()
+    int key = NBUILD;
+    rv = jadwal_build_from(&ht, &key, &key, 1);
+    assert(rv == JADWAL_OK && jadwal_count(&ht) == nkeys + 1);
+    jadwal_deinit(&ht);
+    jadwal_deinit(&reserved_ht);
+}
+
+//the _hashed functions with the hash computed here (the test hash is the identity), and jadwal_remove_iter()
+void test_hashed(void) {
+    enum { NHASHED = 3000 };
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    rv = jadwal_reserve(&ht, NHASHED);
+    assert(rv == JADWAL_OK);
+    long hash_calls_before = hash_calls;
+    for (int key=0; key<NHASHED; key++) {
+        int value = key * 2;
+        rv = jadwal_insert_hashed(&ht, &key, &value, (size_t) key);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_insert_hashed(&ht, &key, &value, (size_t) key);
+        assert(rv == JADWAL_DUPLICATE_KEY);
+    }
+    for (int key=0; key<2*NHASHED; key++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find_hashed(&ht, &key, (size_t) key, &iter);
+        assert(rv == (key < NHASHED ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(rv != JADWAL_OK || *jadwal_iter_value(&iter) == key * 2);
+    }
+    for (int key=0; key<NHASHED; key+=3) {
+        rv = jadwal_remove_hashed(&ht, &key, (size_t) key);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_remove_hashed(&ht, &key, (size_t) key);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+    //a find followed by removing what it found, without a second lookup
+    for (int key=1; key<NHASHED; key+=3) {
+        struct jadwal_iter iter;
+        rv = jadwal_find_hashed(&ht, &key, (size_t) key, &iter);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_remove_iter(&ht, &iter);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_remove_iter(&ht, &iter);
+        assert(rv == JADWAL_NOT_FOUND);
+    }
+#if !defined(JADWAL_DBG) && !defined(JADWAL_HOPSCOTCH)
+    //(debug builds check the hash passed against jadwal_hash(), hopscotch may rehash buckets it moves)
+    assert(hash_calls == hash_calls_before);
+#endif
+    (void) hash_calls_before;
+    assert(jadwal_key_hash(&ht, &(int){77}) == 77);
+    assert(jadwal_count(&ht) == NHASHED / 3);
+    //an iterator whose element was removed since is stale, removing through it removes nothing, even where another
+    //element took the bucket (robin hood shifts the key that collided with it back into it)
+    for (int key=2; key<NHASHED; key+=3*20) {
+        int other = NHASHED;
+        while (jadwal_integer_mod_buckets(&ht, (size_t) other) != jadwal_integer_mod_buckets(&ht, (size_t) key))
+            other++;
+        rv = jadwal_insert_hashed(&ht, &other, &other, (size_t) other);
+        assert(rv == JADWAL_OK);
+        struct jadwal_iter stale;
+        rv = jadwal_find_hashed(&ht, &key, (size_t) key, &stale);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_remove_hashed(&ht, &key, (size_t) key);
+        assert(rv == JADWAL_OK);
+        rv = jadwal_remove_iter(&ht, &stale);
+        assert(rv == JADWAL_NOT_FOUND);
+        rv = jadwal_remove_hashed(&ht, &other, (size_t) other);
+        assert(rv == JADWAL_OK);
+        int value = key * 2;
+        rv = jadwal_insert_hashed(&ht, &key, &value, (size_t) key);
+        assert(rv == JADWAL_OK);
+    }
+    assert(jadwal_count(&ht) == NHASHED / 3);
+    test_check_bucket_counts(&ht);
+#ifdef JADWAL_HOPSCOTCH
+    test_check_hop_bitmaps(&ht);
+#endif
+    //removing while iterating, the iterator is invalid after a removal so iterating starts over
+    long nleft = NHASHED / 3;
+    struct jadwal_iter iter;
+    rv = jadwal_begin_iterator(&ht, &iter);
+    while (rv == JADWAL_OK) {
+        int key = *jadwal_iter_key(&iter);
+        assert(key % 3 == 2);
+        if (key % 2 == 0) {
+            rv = jadwal_iter_next(&ht, &iter);
+            continue;
+        }
+        rv = jadwal_remove_iter(&ht, &iter);
+        assert(rv == JADWAL_OK);
+        nleft--;
+        rv = jadwal_begin_iterator(&ht, &iter);
+    }
+    assert(rv == JADWAL_ITER_STOP && jadwal_count(&ht) == nleft);
+    test_check_bucket_counts(&ht);
+    for (int key=0; key<NHASHED; key++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == (key % 3 == 2 && key % 2 == 0 ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_deinit(&ht);
+}
+
+//counting with jadwal_try_emplace(), the constructor runs once per distinct key
+long test_ctor_calls = 0;
+void test_ctor(jadwal_key_type *key, jadwal_value_type *value, void *arg) {
+    assert(*value == 0 && arg == &test_ctor_calls);
+    test_ctor_calls++;
+    *value = *key * 100;
+}
+void test_try_emplace(void) {
+    enum { NEMPLACE = 20000, NEMPLACE_KEYS = 3000 };
+    static int expected[NEMPLACE_KEYS];
+    memset(expected, 0, sizeof expected);
+    struct jadwal ht;
+    int rv = jadwal_init(&ht, 0);
+    assert(rv == JADWAL_OK);
+#ifdef JADWAL_DATA_ARG
+    ht.userdata = mydata;
+#endif
+    test_ctor_calls = 0;
+    long hash_calls_before = hash_calls;
+    long ndistinct = 0;
+    srand(22);
+    for (int i=0; i<NEMPLACE; i++) {
+        int key = rand() % NEMPLACE_KEYS;
+        jadwal_value_type *value;
+        rv = jadwal_try_emplace(&ht, &key, test_ctor, &test_ctor_calls, &value);
+        assert(rv == (expected[key] ? JADWAL_DUPLICATE_KEY : JADWAL_OK));
+        ndistinct += rv == JADWAL_OK;
+        if (!expected[key])
+            expected[key] = key * 100;
+        assert(*value == expected[key]);
+        ++*value;
+        expected[key]++;
+    }
+#if !defined(JADWAL_DBG) && !defined(JADWAL_STORE_HASH)
+    //one hash per call, and one per element moved by the resizes
+    assert(hash_calls - hash_calls_before <= NEMPLACE + 4 * ndistinct);
+#endif
+    (void) hash_calls_before;
+    assert(test_ctor_calls == ndistinct && jadwal_count(&ht) == ndistinct);
+    test_check_bucket_counts(&ht);
+    for (int key=0; key<NEMPLACE_KEYS; key++) {
+        struct jadwal_iter iter;
+        rv = jadwal_find(&ht, &key, &iter);
+        assert(rv == (expected[key] ? JADWAL_OK : JADWAL_NOT_FOUND));
+        assert(rv != JADWAL_OK || *jadwal_iter_value(&iter) == expected[key]);
+    }
+    //without a constructor the value starts zeroed
+    int key = NEMPLACE_KEYS;
+    jadwal_value_type *value;
+    rv = jadwal_try_emplace(&ht, &key, NULL, NULL, &value);
+    assert(rv == JADWAL_OK && *value == 0);
+    *value = 5;
+    rv = jadwal_try_emplace(&ht, &key, test_ctor, &test_ctor_calls, &value);
+    assert(rv == JADWAL_DUPLICATE_KEY && *value == 5 && test_ctor_calls == ndistinct);
+#ifdef JADWAL_INCREMENTAL
+    //in the middle of a migration, lookups of keys still in the old buckets leave the emplaced value where it is
+    while (!jadwal_resizing(&ht)) {
+        key++;
+        rv = jadwal_try_emplace(&ht, &key, NULL, NULL, &value);
+        assert(rv == JADWAL_OK);
+        *value = key;
+    }
+    key++;
+    rv = jadwal_try_emplace(&ht, &key, test_ctor, &test_ctor_calls, &value);
+    assert(rv == JADWAL_OK && *value == key * 100);
+    static int lookup_keys[NEMPLACE_KEYS];
+    for (int i=0; i<NEMPLACE_KEYS; i++) {
+        struct jadwal_iter iter;
+        lookup_keys[i] = i;
+        rv = jadwal_find(&ht, &i, &iter);
+        assert(rv == (expected[i] ? JADWAL_OK : JADWAL_NOT_FOUND));
+    }
+    jadwal_find_batch(&ht, lookup_keys, NEMPLACE_KEYS, NULL, NULL);
+    assert(jadwal_resizing(&ht));
+    *value = -1;
+    struct jadwal_iter iter;
+    rv = jadwal_find(&ht, &key, &iter);
+    assert(rv == JADWAL_OK && *jadwal_iter_value(&iter) == -1);
+#endif
+    jadwal_deinit(&ht);
+}
+
 int main(void) {
     test_init_add_arrays_find();
+    test_random_ops();
+    test_strided_keys();
+    test_resize_no_key_cmp();
+    test_churn();
+    test_custom_alloc();
+    test_find_batch();
+    test_insert_batch(false);
+    test_insert_batch(true);
+    test_build_from();
+    test_hashed();
+    test_try_emplace();
+#ifdef __SIZEOF_INT128__
+    test_fastmod();
+#endif
+#ifdef JADWAL_STORE_HASH
+    test_store_hash();
+#endif
+#ifdef JADWAL_INCREMENTAL
+    test_incremental();
+#endif
+#ifdef JADWAL_ARENA
+    test_arena();
+#endif
+#ifdef JADWAL_PARALLEL_RESIZE
+    test_parallel_resize();
+#endif
     printf("success\n");
 }